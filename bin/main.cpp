@@ -1,78 +1,83 @@
 #include "../lib/interpreter.h"
-#include <sstream>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
-void runTest(const std::string& name, const std::string& code) {
-    // std::cout << "\n=== " << name << " ===" << std::endl;
-    // std::cout << "Code:\n" << code << std::endl;
-    std::istringstream input(code);
-    std::ostringstream output;
-    bool success = interpret(input, output);
-    std::cout << "Success: " << (success ? "true" : "false") << std::endl;
-    std::cout << "Output: " << output.str() << std::endl;
-}
-
-int main() {
-        runTest("check", R"(
-        a = "InTerPretER"
-        b = lower(a)
-        print(b)
-    )");
-
-    // runTest("Arithmetic and scientific notation", R"(
-    //     a = 1.23e-4
-    //     b = 4.56E2
-    //     c = a + b
-    //     d = b - a
-    //     e = a * b
-    //     f = b / a
-    //     g = 10 % 3
-    //     h = 2 ^ 3
-    //     print(a)  // 0.000123
-    //     print(b)  // 456
-    //     print(c)  // ~456.000123
-    //     print(d)  // ~455.999877
-    //     print(e)  // ~0.056088
-    //     print(f)  // ~3.707317e6
-    //     print(g)  // 1
-    //     print(h)  // 8
-    // )");
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
 
-    // runTest("Comparison operators", R"(
-    //     print(5 == 5)    // 1
-    //     print(5 != 3)    // 1
-    //     print(5 > 3)     // 1
-    //     print(5 < 3)     // 0
-    //     print(5 >= 5)    // 1
-    //     print(3 <= 5)    // 1
-    // )");
+// запуск файла: данные для read() и lines() берутся из стандартного ввода
+int runFile(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Не удалось открыть файл: " << path << std::endl;
+        return 1;
+    }
+    bool success = interpret(file, std::cout, std::cin);
+    std::cout << std::endl;
+    return success ? 0 : 1;
+}
 
-    // runTest("Logical operators", R"(
-    //     print(true and true)    // 1
-    //     print(true and false)   // 0
-    //     print(false or true)    // 1
-    //     print(false or false)   // 0
-    //     print(not false)        // 1
-    //     print(not true)         // 0
-    //     print(1 and 1)         // 1
-    //     print(1 or 0)          // 1
-    //     print(not 0)           // 1
-    // )");
+// интерактивный режим: строки читаются по одной и выполняются в общем сеансе
+int runRepl() {
+    bool interactive = true;
+#if defined(__unix__) || defined(__APPLE__)
+    interactive = isatty(STDIN_FILENO);
+#endif
+    std::istringstream no_data;
+    std::ostringstream output;
+    Session session(output, no_data);
+    auto flush = [&]() { // вывод ввода заканчивается переводом строки, чтобы не слипаться с приглашением
+        std::string text = output.str();
+        if (text.empty()) return;
+        std::cout << text;
+        if (text.back() != '\n') std::cout << '\n';
+        output.str("");
+    };
+    Session::Status status = Session::Status::Done;
+    std::string line;
+    while (true) {
+        if (interactive) std::cout << (status == Session::Status::NeedMore ? "... " : "> ") << std::flush;
+        if (!std::getline(std::cin, line)) break;
+        status = session.feed(line);
+        flush();
+    }
+    if (status == Session::Status::NeedMore) {
+        // незаконченная инструкция в конце ввода завершается принудительно
+        session.feed("");
+        flush();
+    }
+    if (interactive) std::cout << std::endl;
+    return 0;
+}
 
-    // runTest("Complex expressions", R"(
-    //     a = 2 + 3 * 4         // 14
-    //     b = (2 + 3) * 4       // 20
-    //     c = 2 ^ 3 + 4         // 12
-    //     d = 2 ^ (3 + 4)       // 128
-    //     e = 10 > 5 and 5 < 7  // 1
-    //     f = not (10 < 5)      // 1
-    //     print(a)
-    //     print(b)
-    //     print(c)
-    //     print(d)
-    //     print(e)
-    //     print(f)
-    // )");
+// --dump-ast: вывод дерева после оптимизации вместо выполнения
+int dumpFile(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Не удалось открыть файл: " << path << std::endl;
+        return 1;
+    }
+    bool success = dump_optimized_ast(file, std::cout);
+    if (!success) std::cout << std::endl;
+    return success ? 0 : 1;
+}
 
-    return 0;
-}
\ No newline at end of file
+int main(int argc, char** argv) {
+    int arg = 1;
+    // --max-depth N: ограничение глубины вложенных вызовов функций скрипта
+    if (argc > arg + 1 && std::string(argv[arg]) == "--max-depth") {
+        try {
+            set_max_call_depth(std::stoul(argv[arg + 1]));
+        } catch (const std::exception&) {
+            std::cerr << "Невалидная глубина вызовов: " << argv[arg + 1] << std::endl;
+            return 1;
+        }
+        arg += 2;
+    }
+    if (argc > arg + 1 && std::string(argv[arg]) == "--dump-ast") return dumpFile(argv[arg + 1]);
+    if (argc > arg) return runFile(argv[arg]);
+    return runRepl();
+}
@@ -1,16 +1,52 @@
 #include "interpreter.h"
 #include "parser/parser.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/resolver.h"
 #include "runtime/evaluator.h"
 #include "runtime/environment.h"
 #include "runtime/utils.h"
 #include "runtime/types.h"
+#include "runtime/line_reader.h"
+#include "runtime/file_io.h"
+#include "runtime/pool.h"
+#include <sstream>
 #include <stdexcept>
+#include <unordered_set>
 
 bool interpret(std::istream& input, std::ostream& output) {
+    std::istringstream no_data;
+    return interpret(input, output, no_data);
+}
+
+void set_max_call_depth(size_t depth) {
+    set_call_depth_limit(depth);
+}
+
+bool dump_optimized_ast(std::istream& input, std::ostream& output) {
+    try {
+        Lexer lexer(input);
+        Parser parser(lexer);
+        auto ast = parser.parse();
+        optimize(ast);
+        resolve_slots(ast);
+        dump_ast(output, ast);
+        return true;
+    } catch (const std::exception& e) {
+        output << "Ошибка: " << e.what();
+        return false;
+    }
+}
+
+bool interpret(std::istream& input, std::ostream& output, std::istream& data) {
+    HeapPool heap; // переживает все значения и дерево программы (кэши инвариантов)
+    HeapPool::Scope heap_scope(heap);
+    g_input_reader = std::make_shared<LineReader>(data);
     try {
         Lexer lexer(input);
         Parser parser(lexer);
         auto ast = parser.parse();
+        optimize(ast);
+        resolve_slots(ast);
         Environment env;
 
         std::vector<Value> print_values;
@@ -20,53 +56,95 @@ bool interpret(std::istream& input, std::ostream& output) {
         }
         g_print_values = nullptr;
 
-        for (size_t i = 0; i < print_values.size(); ++i) {
-            const auto& value = print_values[i];
-            if (std::holds_alternative<NullType>(value)) {
-                output << "nil";
-                continue;
-            }
-            if (std::holds_alternative<double>(value)) {
-                output << format_number(std::get<double>(value));
-            } else if (std::holds_alternative<std::string>(value)) {
-                output << std::get<std::string>(value);
-            } else if (std::holds_alternative<List>(value)) {
-                const List& list = std::get<List>(value);
-                output << "[";
-                for (size_t j = 0; j < list->elements.size(); ++j) {
-                    if (j > 0) {
-                        output << ", ";
-                    }
-                    const Value& elem = list->elements[j];
-                    if (std::holds_alternative<NullType>(elem)) {
-                        output << "nil";
-                    } else if (std::holds_alternative<double>(elem)) {
-                        output << format_number(std::get<double>(elem));
-                    } else if (std::holds_alternative<std::string>(elem)) {
-                        output << "\"" << std::get<std::string>(elem) << "\"";
-                    } else if (std::holds_alternative<List>(elem)) {
-                        const List& nested = std::get<List>(elem);
-                        output << "[";
-                        for (size_t k = 0; k < nested->elements.size(); ++k) {
-                            if (k > 0) output << ", ";
-                            const Value& nelem = nested->elements[k];
-                            if (std::holds_alternative<NullType>(nelem)) {
-                                output << "nil";
-                            } else if (std::holds_alternative<double>(nelem)) {
-                                output << format_number(std::get<double>(nelem));
-                            } else if (std::holds_alternative<std::string>(nelem)) {
-                                output << "\"" << std::get<std::string>(nelem) << "\"";
-                            }
-                        }
-                        output << "]";
-                    }
-                }
-                output << "]";
-            }
+        for (const auto& value : print_values) {
+            write_value(output, value);
         }
+        g_input_reader = nullptr;
+        close_files();
         return true;
     } catch (const std::exception& e) {
+        g_input_reader = nullptr;
+        close_files();
         output << "Ошибка: " << e.what();
         return false;
     }
-}
\ No newline at end of file
+}
+
+struct Session::State {
+    HeapPool heap; // объявлен первым: удаляется после всех значений сеанса
+    std::ostream& output;
+    std::shared_ptr<LineReader> reader;
+    Environment env;
+    std::vector<std::unique_ptr<ASTNode>> program; // функции ссылаются на узлы, поэтому разобранное хранится весь сеанс
+    std::string pending;                           // начало незаконченной инструкции
+    std::unordered_set<std::string> bound_names;   // имена, связанные за сеанс (для оптимизатора)
+
+    State(std::ostream& out, std::istream& data) : output(out), reader(std::make_shared<LineReader>(data)) {}
+};
+
+Session::Session(std::ostream& output, std::istream& data) : state_(std::make_unique<State>(output, data)) {}
+
+Session::~Session() = default;
+
+Session::Status Session::feed(const std::string& line) {
+    State& state = *state_;
+    HeapPool::Scope heap_scope(state.heap);
+    bool force = line.find_first_not_of(" \t\r") == std::string::npos;
+    state.pending += line;
+    state.pending += '\n';
+
+    // разбирается только накопленный ввод, а не вся история сеанса
+    std::vector<std::unique_ptr<ASTNode>> statements;
+    try {
+        std::istringstream input(state.pending);
+        Lexer lexer(input);
+        Parser parser(lexer);
+        while (auto statement = parser.parse_next()) {
+            statements.push_back(std::move(statement));
+        }
+    } catch (const IncompleteInputError& e) {
+        if (!force) return Status::NeedMore;
+        state.pending.clear();
+        state.output << "Ошибка: " << e.what();
+        return Status::Error;
+    } catch (const std::exception& e) {
+        state.pending.clear();
+        state.output << "Ошибка: " << e.what();
+        return Status::Error;
+    }
+    state.pending.clear();
+    optimize(statements, state.bound_names);
+    resolve_slots(statements);
+
+    std::vector<Value> print_values;
+    g_print_values = &print_values;
+    g_input_reader = state.reader;
+    Status status = Status::Done;
+    for (auto& statement : statements) {
+        std::string error;
+        try {
+            execNode(statement.get(), state.env, print_values);
+        } catch (const std::exception& e) {
+            error = e.what();
+        } catch (const ReturnException&) {
+            error = "return вне функции";
+        } catch (const BreakException&) {
+            error = "break вне цикла";
+        } catch (const ContinueException&) {
+            error = "continue вне цикла";
+        }
+        // вывод каждой инструкции показывается сразу после ее выполнения
+        for (const auto& value : print_values) write_value(state.output, value);
+        print_values.clear();
+        if (!error.empty()) {
+            state.output << "Ошибка: " << error;
+            status = Status::Error;
+        }
+        state.program.push_back(std::move(statement));
+        if (status == Status::Error) break;
+    }
+    g_print_values = nullptr;
+    g_input_reader = nullptr;
+    close_files();
+    return status;
+}
@@ -1,3 +1,35 @@
+#pragma once
 #include <iostream>
+#include <memory>
+#include <string>
     
-bool interpret(std::istream& input, std::ostream& output);
\ No newline at end of file
+bool interpret(std::istream& input, std::ostream& output);
+// data - поток данных, который скрипт читает через read() и lines()
+bool interpret(std::istream& input, std::ostream& output, std::istream& data);
+// максимальная глубина вложенных вызовов функций скрипта (по умолчанию 5000);
+// более глубокая рекурсия завершается ошибкой, а не переполнением стека
+void set_max_call_depth(size_t depth);
+// разбор и оптимизация без выполнения: в output выводится оптимизированное дерево
+bool dump_optimized_ast(std::istream& input, std::ostream& output);
+
+// интерактивный сеанс: переменные и функции живут между вводами,
+// а каждый ввод разбирается и выполняется отдельно от предыдущих
+class Session {
+public:
+    enum class Status {
+        Done,      // ввод выполнен
+        NeedMore,  // инструкция не закончена, нужен следующий ввод
+        Error      // ошибка разбора или выполнения, сообщение выведено в output
+    };
+
+    Session(std::ostream& output, std::istream& data);
+    ~Session();
+
+    // очередная строка ввода; незаконченная инструкция копится до следующих строк,
+    // а пустая строка завершает ее принудительно
+    Status feed(const std::string& line);
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
@@ -4,6 +4,7 @@
 #include <sstream>
 
 void Lexer::read_char() { // чтение 1 символа из входного потка
+    if (current_char_ == '\n') ++line_;
     current_char_ = input_.get();
 }
 
@@ -54,7 +55,7 @@ std::string Lexer::read_string() {
     }
     
     if (current_char_ == EOF) {
-        throw std::runtime_error("Прерванный строковый литерал");
+        throw IncompleteInputError("Прерванный строковый литерал");
     }
     
     read_char();
@@ -120,7 +121,14 @@ void Lexer::expect(TokenType type) { // проверка соотв текуще
 }
 
 Token Lexer::next_token() { // осн функция: читает вход поток, опред каждый токен, возвращает структуру Token
+    read_token();
+    current_token_.line = token_line_;
+    return current_token_;
+}
+
+Token Lexer::read_token() {
     skip_whitespace(); // пропуск пробелов и комментариев
+    token_line_ = line_;
     
     if (current_char_ == EOF) { // проверка на конец файла
         current_token_ = Token{TokenType::END_OF_FILE, ""};
@@ -159,6 +167,7 @@ Token Lexer::next_token() { // осн функция: читает вход по
         else if (identifier == "nil") current_token_ = Token{TokenType::NIL, identifier};
         else if (identifier == "function") current_token_ = Token{TokenType::FUNCTION, identifier};
         else if (identifier == "return") current_token_ = Token{TokenType::RETURN, identifier};
+        else if (identifier == "yield") current_token_ = Token{TokenType::YIELD, identifier};
         else if (identifier == "if") current_token_ = Token{TokenType::IF, identifier};
         else if (identifier == "then") current_token_ = Token{TokenType::THEN, identifier};
         else if (identifier == "else") current_token_ = Token{TokenType::ELSE, identifier};
@@ -183,6 +192,8 @@ Token Lexer::next_token() { // осн функция: читает вход по
         case ')': current_token_ = Token{TokenType::RIGHT_PAREN, ")"}; break;
         case '[': current_token_ = Token{TokenType::LEFT_BRACKET, "["}; break;
         case ']': current_token_ = Token{TokenType::RIGHT_BRACKET, "]"}; break;
+        case '{': current_token_ = Token{TokenType::LEFT_BRACE, "{"}; break;
+        case '}': current_token_ = Token{TokenType::RIGHT_BRACE, "}"}; break;
         case ',': current_token_ = Token{TokenType::COMMA, ","}; break;
         case ':': current_token_ = Token{TokenType::COLON, ":"}; break;
         case '+':
@@ -204,7 +215,7 @@ Token Lexer::next_token() { // осн функция: читает вход по
         case '/':
             if (current_char_ == '/') {
                 skip_line_comment();
-                return next_token();
+                return read_token();
             }
             if (current_char_ == '=') {
                 read_char();
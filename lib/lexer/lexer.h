@@ -6,6 +6,7 @@
 #include <sstream>
 #include <iostream>
 #include <cstdlib>
+#include <stdexcept>
 
 // типы токенов
 enum class TokenType {
@@ -18,6 +19,7 @@ enum class TokenType {
     NIL,
     FUNCTION,
     RETURN,
+    YIELD,
     IF,
     THEN,
     ELSE,
@@ -63,6 +65,8 @@ enum class TokenType {
     RIGHT_PAREN,
     LEFT_BRACKET,
     RIGHT_BRACKET,
+    LEFT_BRACE,
+    RIGHT_BRACE,
     COLON,
     SEMICOLON,
     COMMA,
@@ -82,6 +86,8 @@ inline std::string token_type_to_string(TokenType type) {
         case TokenType::RIGHT_PAREN: return "RIGHT_PAREN";
         case TokenType::LEFT_BRACKET: return "LEFT_BRACKET";
         case TokenType::RIGHT_BRACKET: return "RIGHT_BRACKET";
+        case TokenType::LEFT_BRACE: return "LEFT_BRACE";
+        case TokenType::RIGHT_BRACE: return "RIGHT_BRACE";
         case TokenType::COLON: return "COLON";
         case TokenType::PLUS: return "PLUS";
         case TokenType::MINUS: return "MINUS";
@@ -120,16 +126,23 @@ inline std::string token_type_to_string(TokenType type) {
         case TokenType::CONTINUE: return "CONTINUE";
         case TokenType::FUNCTION: return "FUNCTION";
         case TokenType::RETURN: return "RETURN";
+        case TokenType::YIELD: return "YIELD";
         case TokenType::ERROR: return "ERROR";
         default: return "UNKNOWN";
     }
 }
 
+// ошибка из-за преждевременного конца ввода: в интерактивном режиме ввод можно продолжить
+struct IncompleteInputError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
 struct Token {
     TokenType type;
     std::string value;
     double number_value = 0.0;
     std::string string_value;
+    int line = 0; // строка начала токена, с 1
 
     std::string to_string() const {
         std::stringstream ss;
@@ -152,13 +165,17 @@ public:
 
     Token next_token();
     Token current_token() const { return current_token_; }
+    int line() const { return line_; } // текущая строка ввода
     void expect(TokenType type);
 
 private:
     std::istream& input_;
     char current_char_ = 0;
     Token current_token_;
+    int line_ = 1;
+    int token_line_ = 1;
 
+    Token read_token();
     void read_char();
     char peek_next_char();
     void skip_whitespace();
@@ -0,0 +1,705 @@
+#include "optimizer.h"
+#include "runtime/operations.h"
+#include "runtime/utils.h"
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <unordered_set>
+
+namespace {
+
+bool is_literal(const ASTNode* node) {
+    return dynamic_cast<const NumberNode*>(node) || dynamic_cast<const StringNode*>(node) ||
+           dynamic_cast<const NullNode*>(node);
+}
+
+Value literal_value(const ASTNode* node) {
+    if (auto number = dynamic_cast<const NumberNode*>(node)) return number->value;
+    if (auto string = dynamic_cast<const StringNode*>(node)) return Str(string->value);
+    return NullType{};
+}
+
+// узел-литерал для значения; nullptr, если значение не выражается литералом (списки и т.п.)
+std::unique_ptr<ASTNode> make_literal(const Value& value) {
+    if (auto number = std::get_if<double>(&value)) return std::make_unique<NumberNode>(*number);
+    if (auto string = std::get_if<Str>(&value)) return std::make_unique<StringNode>(string->str());
+    if (std::holds_alternative<NullType>(value)) return std::make_unique<NullNode>();
+    return nullptr;
+}
+
+bool is_number(const ASTNode* node, double value) {
+    auto number = dynamic_cast<const NumberNode*>(node);
+    return number && number->value == value;
+}
+
+// c - нейтральный элемент op для чисел с той стороны, где стоит литерал
+bool is_numeric_identity(TokenType op, const ASTNode* constant, bool constant_right) {
+    switch (op) {
+        case TokenType::PLUS: return is_number(constant, 0);
+        case TokenType::MULTIPLY: return is_number(constant, 1);
+        case TokenType::MINUS:
+        case TokenType::DIVIDE:
+        case TokenType::POWER:
+            return constant_right && is_number(constant, op == TokenType::MINUS ? 0 : 1);
+        default: return false;
+    }
+}
+
+void optimize_block(std::vector<std::unique_ptr<ASTNode>>& block);
+
+// allow_string - можно ли заменить выражение строковым литералом: print "..." печатает
+// литерал с пробелами в кавычках, поэтому его аргумент в строку не сворачивается
+void optimize_expr(std::unique_ptr<ASTNode>& node, bool allow_string = true) {
+    if (!node) return;
+    ASTNode* raw = node.get();
+    if (auto binary = dynamic_cast<BinaryOpNode*>(raw)) {
+        optimize_expr(binary->left);
+        optimize_expr(binary->right);
+        bool left_literal = is_literal(binary->left.get());
+        bool right_literal = is_literal(binary->right.get());
+        if (left_literal && right_literal) {
+            // ошибка (деление на ноль, несовместимые типы) остается до выполнения
+            try {
+                Value result = apply_binary_op(literal_value(binary->left.get()),
+                                               literal_value(binary->right.get()), binary->op);
+                if (allow_string || !std::holds_alternative<Str>(result)) {
+                    if (auto literal = make_literal(result)) node = std::move(literal);
+                }
+            } catch (const std::exception&) {
+            }
+            return;
+        }
+        if (right_literal && is_numeric_identity(binary->op, binary->right.get(), true)) {
+            std::unique_ptr<BinaryOpNode> op(static_cast<BinaryOpNode*>(node.release()));
+            node = std::make_unique<NumericIdentityNode>(std::move(op), true);
+        } else if (left_literal && is_numeric_identity(binary->op, binary->left.get(), false)) {
+            std::unique_ptr<BinaryOpNode> op(static_cast<BinaryOpNode*>(node.release()));
+            node = std::make_unique<NumericIdentityNode>(std::move(op), false);
+        }
+        return;
+    }
+    if (auto unary = dynamic_cast<UnaryOpNode*>(raw)) {
+        optimize_expr(unary->operand);
+        if (is_literal(unary->operand.get())) {
+            try {
+                Value result = apply_unary_op(unary->op, literal_value(unary->operand.get()));
+                if (auto literal = make_literal(result)) node = std::move(literal);
+            } catch (const std::exception&) {
+            }
+        }
+        return;
+    }
+    if (auto assign = dynamic_cast<AssignNode*>(raw)) {
+        optimize_expr(assign->value);
+    } else if (auto assign = dynamic_cast<IndexAssignNode*>(raw)) {
+        optimize_expr(assign->container);
+        optimize_expr(assign->index);
+        optimize_expr(assign->value);
+    } else if (auto index = dynamic_cast<IndexNode*>(raw)) {
+        optimize_expr(index->str);
+        optimize_expr(index->index);
+    } else if (auto slice = dynamic_cast<SliceNode*>(raw)) {
+        optimize_expr(slice->str);
+        optimize_expr(slice->start);
+        optimize_expr(slice->end);
+    } else if (auto list = dynamic_cast<ListNode*>(raw)) {
+        for (auto& element : list->elements) optimize_expr(element);
+    } else if (auto map = dynamic_cast<MapNode*>(raw)) {
+        for (auto& entry : map->entries) {
+            optimize_expr(entry.first);
+            optimize_expr(entry.second);
+        }
+    } else if (auto call = dynamic_cast<CallNode*>(raw)) {
+        optimize_expr(call->callee);
+        for (auto& argument : call->arguments) optimize_expr(argument);
+    } else if (auto function = dynamic_cast<FunctionNode*>(raw)) {
+        optimize_block(function->body);
+    }
+}
+
+// оптимизация инструкции; результат - инструкции, которыми она заменяется
+// (ветвь if с константным условием встраивается в объемлющий блок: своих областей видимости у блоков нет)
+void optimize_statement(std::unique_ptr<ASTNode> statement, std::vector<std::unique_ptr<ASTNode>>& out) {
+    ASTNode* raw = statement.get();
+    if (auto print = dynamic_cast<PrintNode*>(raw)) {
+        optimize_expr(print->expr, false);
+    } else if (auto ret = dynamic_cast<ReturnNode*>(raw)) {
+        optimize_expr(ret->expr);
+    } else if (auto yield = dynamic_cast<YieldNode*>(raw)) {
+        optimize_expr(yield->expr);
+    } else if (auto ifNode = dynamic_cast<IfNode*>(raw)) {
+        std::vector<std::pair<std::unique_ptr<ASTNode>, std::vector<std::unique_ptr<ASTNode>>>> branches;
+        for (auto& branch : ifNode->branches) {
+            optimize_expr(branch.first);
+            if (is_literal(branch.first.get())) {
+                if (!isTruthy(literal_value(branch.first.get()))) continue; // ветвь никогда не выполняется
+                // ветвь выполняется всегда: она становится else, последующие отбрасываются
+                ifNode->else_branch = std::move(branch.second);
+                break;
+            }
+            optimize_block(branch.second);
+            branches.push_back(std::move(branch));
+        }
+        ifNode->branches = std::move(branches);
+        optimize_block(ifNode->else_branch);
+        if (ifNode->branches.empty()) {
+            for (auto& inner : ifNode->else_branch) out.push_back(std::move(inner));
+            return;
+        }
+    } else if (auto forNode = dynamic_cast<ForNode*>(raw)) {
+        optimize_expr(forNode->iterable);
+        optimize_block(forNode->body);
+    } else if (auto whileNode = dynamic_cast<WhileNode*>(raw)) {
+        optimize_expr(whileNode->condition);
+        if (is_literal(whileNode->condition.get()) && !isTruthy(literal_value(whileNode->condition.get()))) {
+            return; // тело никогда не выполняется
+        }
+        optimize_block(whileNode->body);
+    } else {
+        optimize_expr(statement);
+    }
+    out.push_back(std::move(statement));
+}
+
+void optimize_block(std::vector<std::unique_ptr<ASTNode>>& block) {
+    std::vector<std::unique_ptr<ASTNode>> result;
+    result.reserve(block.size());
+    for (auto& statement : block) optimize_statement(std::move(statement), result);
+    block = std::move(result);
+}
+
+// встроенные функции без побочных эффектов: их вызов с инвариантными аргументами можно выносить из цикла
+const std::unordered_set<std::string>& pure_builtins() {
+    static const std::unordered_set<std::string> names = {
+        "len", "abs", "ceil", "floor", "round", "sqrt", "parse_num", "to_string", "lower", "upper",
+        "split", "join", "replace", "find", "contains", "starts_with", "count", "sum", "min", "max",
+        "mean", "argmin", "argmax", "dot", "count_if_gt", "count_if_lt", "keys", "values", "has",
+        "union", "intersect", "difference"};
+    return names;
+}
+
+// встроенные функции, которые не меняют существующие списки, словари, множества и построители
+const std::unordered_set<std::string>& non_mutating_builtins() {
+    static const std::unordered_set<std::string> names = {
+        "print", "println", "range", "read", "eof", "lines", "read_file", "file_lines", "write_file",
+        "append_file", "stacktrace", "rnd", "builder", "build", "array", "zeros", "linspace", "set"};
+    return names;
+}
+
+// что цикл делает с окружением
+struct LoopFacts {
+    std::unordered_set<std::string> assigned; // переменные, которым цикл присваивает
+    bool mutates = false;                     // цикл может изменить содержимое контейнеров
+    const std::unordered_set<std::string>* bound; // имена, которые программа где-либо связывает
+};
+
+bool is_builtin_call(const CallNode* call, const std::unordered_set<std::string>& names,
+                     const std::unordered_set<std::string>& bound) {
+    auto callee = dynamic_cast<const VariableNode*>(call->callee.get());
+    return callee && names.count(callee->name) && !bound.count(callee->name);
+}
+
+void scan_block(const std::vector<std::unique_ptr<ASTNode>>& block, LoopFacts& facts);
+
+void scan(const ASTNode* node, LoopFacts& facts) {
+    if (!node || dynamic_cast<const FunctionNode*>(node)) return; // тело функции выполняется в своем окружении
+    if (auto binary = dynamic_cast<const BinaryOpNode*>(node)) {
+        scan(binary->left.get(), facts);
+        scan(binary->right.get(), facts);
+    } else if (auto identity = dynamic_cast<const NumericIdentityNode*>(node)) {
+        scan(identity->op.get(), facts);
+    } else if (auto unary = dynamic_cast<const UnaryOpNode*>(node)) {
+        scan(unary->operand.get(), facts);
+    } else if (auto invariant = dynamic_cast<const InvariantNode*>(node)) {
+        scan(invariant->expr.get(), facts);
+    } else if (auto assign = dynamic_cast<const AssignNode*>(node)) {
+        facts.assigned.insert(assign->var_name);
+        // += и *= дописывают список на место, и это видно через другие ссылки на него
+        if (assign->op == TokenType::PLUS_EQUALS || assign->op == TokenType::MULTIPLY_EQUALS) facts.mutates = true;
+        scan(assign->value.get(), facts);
+    } else if (auto assign = dynamic_cast<const IndexAssignNode*>(node)) {
+        facts.mutates = true; // элемент меняется на месте
+        scan(assign->container.get(), facts);
+        scan(assign->index.get(), facts);
+        scan(assign->value.get(), facts);
+    } else if (auto print = dynamic_cast<const PrintNode*>(node)) {
+        scan(print->expr.get(), facts);
+    } else if (auto ret = dynamic_cast<const ReturnNode*>(node)) {
+        scan(ret->expr.get(), facts);
+    } else if (auto yield = dynamic_cast<const YieldNode*>(node)) {
+        scan(yield->expr.get(), facts);
+    } else if (auto index = dynamic_cast<const IndexNode*>(node)) {
+        scan(index->str.get(), facts);
+        scan(index->index.get(), facts);
+    } else if (auto slice = dynamic_cast<const SliceNode*>(node)) {
+        scan(slice->str.get(), facts);
+        scan(slice->start.get(), facts);
+        scan(slice->end.get(), facts);
+    } else if (auto list = dynamic_cast<const ListNode*>(node)) {
+        scan_block(list->elements, facts);
+    } else if (auto map = dynamic_cast<const MapNode*>(node)) {
+        for (const auto& entry : map->entries) {
+            scan(entry.first.get(), facts);
+            scan(entry.second.get(), facts);
+        }
+    } else if (auto call = dynamic_cast<const CallNode*>(node)) {
+        // пользовательская функция может изменить переданный ей список
+        if (!is_builtin_call(call, pure_builtins(), *facts.bound) &&
+            !is_builtin_call(call, non_mutating_builtins(), *facts.bound)) {
+            facts.mutates = true;
+        }
+        scan(call->callee.get(), facts);
+        scan_block(call->arguments, facts);
+    } else if (auto ifNode = dynamic_cast<const IfNode*>(node)) {
+        for (const auto& branch : ifNode->branches) {
+            scan(branch.first.get(), facts);
+            scan_block(branch.second, facts);
+        }
+        scan_block(ifNode->else_branch, facts);
+    } else if (auto forNode = dynamic_cast<const ForNode*>(node)) {
+        facts.assigned.insert(forNode->var_name);
+        // следующий элемент итератора может вычислять тело генератора
+        auto source = dynamic_cast<const CallNode*>(forNode->iterable.get());
+        if (!dynamic_cast<const ListNode*>(forNode->iterable.get()) &&
+            !(source && (is_builtin_call(source, pure_builtins(), *facts.bound) ||
+                         is_builtin_call(source, non_mutating_builtins(), *facts.bound)))) {
+            facts.mutates = true;
+        }
+        scan(forNode->iterable.get(), facts);
+        scan_block(forNode->body, facts);
+    } else if (auto whileNode = dynamic_cast<const WhileNode*>(node)) {
+        scan(whileNode->condition.get(), facts);
+        scan_block(whileNode->body, facts);
+    }
+}
+
+void scan_block(const std::vector<std::unique_ptr<ASTNode>>& block, LoopFacts& facts) {
+    for (const auto& node : block) scan(node.get(), facts);
+}
+
+// значение выражения не меняется между итерациями цикла
+bool is_invariant(const ASTNode* node, const LoopFacts& facts) {
+    if (!node) return true; // отсутствующая граница среза
+    if (is_literal(node) || dynamic_cast<const InvariantNode*>(node)) return true;
+    if (auto variable = dynamic_cast<const VariableNode*>(node)) return !facts.assigned.count(variable->name);
+    if (auto binary = dynamic_cast<const BinaryOpNode*>(node)) {
+        return is_invariant(binary->left.get(), facts) && is_invariant(binary->right.get(), facts);
+    }
+    if (auto identity = dynamic_cast<const NumericIdentityNode*>(node)) return is_invariant(identity->op.get(), facts);
+    if (auto unary = dynamic_cast<const UnaryOpNode*>(node)) return is_invariant(unary->operand.get(), facts);
+    if (auto index = dynamic_cast<const IndexNode*>(node)) {
+        return is_invariant(index->str.get(), facts) && is_invariant(index->index.get(), facts);
+    }
+    if (auto slice = dynamic_cast<const SliceNode*>(node)) {
+        return is_invariant(slice->str.get(), facts) && is_invariant(slice->start.get(), facts) &&
+               is_invariant(slice->end.get(), facts);
+    }
+    if (auto call = dynamic_cast<const CallNode*>(node)) {
+        if (!is_builtin_call(call, pure_builtins(), *facts.bound)) return false;
+        for (const auto& argument : call->arguments) {
+            if (!is_invariant(argument.get(), facts)) return false;
+        }
+        return true;
+    }
+    return false; // литералы списков и словарей, функции: каждое вычисление дает новое значение
+}
+
+// выносить имеет смысл только то, что дороже чтения переменной
+bool worth_hoisting(const ASTNode* node) {
+    return dynamic_cast<const BinaryOpNode*>(node) || dynamic_cast<const NumericIdentityNode*>(node) ||
+           dynamic_cast<const UnaryOpNode*>(node) || dynamic_cast<const IndexNode*>(node) ||
+           dynamic_cast<const SliceNode*>(node) || dynamic_cast<const CallNode*>(node);
+}
+
+void collect_inputs(const ASTNode* node, std::vector<const VariableNode*>& inputs) {
+    if (!node) return;
+    if (auto variable = dynamic_cast<const VariableNode*>(node)) {
+        auto same_name = [&](const VariableNode* input) { return input->name == variable->name; };
+        if (std::none_of(inputs.begin(), inputs.end(), same_name)) inputs.push_back(variable);
+    } else if (auto binary = dynamic_cast<const BinaryOpNode*>(node)) {
+        collect_inputs(binary->left.get(), inputs);
+        collect_inputs(binary->right.get(), inputs);
+    } else if (auto identity = dynamic_cast<const NumericIdentityNode*>(node)) {
+        collect_inputs(identity->op.get(), inputs);
+    } else if (auto unary = dynamic_cast<const UnaryOpNode*>(node)) {
+        collect_inputs(unary->operand.get(), inputs);
+    } else if (auto index = dynamic_cast<const IndexNode*>(node)) {
+        collect_inputs(index->str.get(), inputs);
+        collect_inputs(index->index.get(), inputs);
+    } else if (auto slice = dynamic_cast<const SliceNode*>(node)) {
+        collect_inputs(slice->str.get(), inputs);
+        collect_inputs(slice->start.get(), inputs);
+        collect_inputs(slice->end.get(), inputs);
+    } else if (auto call = dynamic_cast<const CallNode*>(node)) {
+        for (const auto& argument : call->arguments) collect_inputs(argument.get(), inputs);
+    }
+    // значение InvariantNode внешнего цикла уже постоянно, его входы не нужны
+}
+
+void hoist_block(std::vector<std::unique_ptr<ASTNode>>& block, const LoopFacts& facts,
+                 std::vector<const InvariantNode*>& invariants);
+
+// максимальные инвариантные подвыражения заменяются на InvariantNode
+void hoist_expr(std::unique_ptr<ASTNode>& node, const LoopFacts& facts, std::vector<const InvariantNode*>& invariants) {
+    if (!node) return;
+    ASTNode* raw = node.get();
+    if (dynamic_cast<InvariantNode*>(raw) || dynamic_cast<FunctionNode*>(raw)) return;
+    if (worth_hoisting(raw) && is_invariant(raw, facts)) {
+        std::vector<const VariableNode*> inputs;
+        collect_inputs(raw, inputs);
+        auto invariant = std::make_unique<InvariantNode>(std::move(node), std::move(inputs), facts.mutates,
+                                                         std::make_shared<InvariantCache>());
+        invariants.push_back(invariant.get());
+        node = std::move(invariant);
+        return;
+    }
+    if (auto binary = dynamic_cast<BinaryOpNode*>(raw)) {
+        hoist_expr(binary->left, facts, invariants);
+        hoist_expr(binary->right, facts, invariants);
+    } else if (auto identity = dynamic_cast<NumericIdentityNode*>(raw)) {
+        hoist_expr(identity->op->left, facts, invariants);
+        hoist_expr(identity->op->right, facts, invariants);
+    } else if (auto unary = dynamic_cast<UnaryOpNode*>(raw)) {
+        hoist_expr(unary->operand, facts, invariants);
+    } else if (auto assign = dynamic_cast<AssignNode*>(raw)) {
+        hoist_expr(assign->value, facts, invariants);
+    } else if (auto assign = dynamic_cast<IndexAssignNode*>(raw)) {
+        hoist_expr(assign->container, facts, invariants);
+        hoist_expr(assign->index, facts, invariants);
+        hoist_expr(assign->value, facts, invariants);
+    } else if (auto print = dynamic_cast<PrintNode*>(raw)) {
+        hoist_expr(print->expr, facts, invariants);
+    } else if (auto ret = dynamic_cast<ReturnNode*>(raw)) {
+        hoist_expr(ret->expr, facts, invariants);
+    } else if (auto index = dynamic_cast<IndexNode*>(raw)) {
+        hoist_expr(index->str, facts, invariants);
+        hoist_expr(index->index, facts, invariants);
+    } else if (auto slice = dynamic_cast<SliceNode*>(raw)) {
+        hoist_expr(slice->str, facts, invariants);
+        hoist_expr(slice->start, facts, invariants);
+        hoist_expr(slice->end, facts, invariants);
+    } else if (auto list = dynamic_cast<ListNode*>(raw)) {
+        hoist_block(list->elements, facts, invariants);
+    } else if (auto map = dynamic_cast<MapNode*>(raw)) {
+        for (auto& entry : map->entries) {
+            hoist_expr(entry.first, facts, invariants);
+            hoist_expr(entry.second, facts, invariants);
+        }
+    } else if (auto call = dynamic_cast<CallNode*>(raw)) {
+        hoist_block(call->arguments, facts, invariants);
+    } else if (auto ifNode = dynamic_cast<IfNode*>(raw)) {
+        for (auto& branch : ifNode->branches) {
+            hoist_expr(branch.first, facts, invariants);
+            hoist_block(branch.second, facts, invariants);
+        }
+        hoist_block(ifNode->else_branch, facts, invariants);
+    } else if (auto forNode = dynamic_cast<ForNode*>(raw)) {
+        hoist_expr(forNode->iterable, facts, invariants);
+        hoist_block(forNode->body, facts, invariants);
+    } else if (auto whileNode = dynamic_cast<WhileNode*>(raw)) {
+        hoist_expr(whileNode->condition, facts, invariants);
+        hoist_block(whileNode->body, facts, invariants);
+    }
+}
+
+void hoist_block(std::vector<std::unique_ptr<ASTNode>>& block, const LoopFacts& facts,
+                 std::vector<const InvariantNode*>& invariants) {
+    for (auto& node : block) hoist_expr(node, facts, invariants);
+}
+
+void collect_bound_names(const ASTNode* node, std::unordered_set<std::string>& bound);
+
+void collect_bound_names(const std::vector<std::unique_ptr<ASTNode>>& block, std::unordered_set<std::string>& bound) {
+    for (const auto& node : block) collect_bound_names(node.get(), bound);
+}
+
+// имена, которые программа связывает присваиванием, циклом for или параметром функции
+void collect_bound_names(const ASTNode* node, std::unordered_set<std::string>& bound) {
+    if (!node) return;
+    if (auto binary = dynamic_cast<const BinaryOpNode*>(node)) {
+        collect_bound_names(binary->left.get(), bound);
+        collect_bound_names(binary->right.get(), bound);
+    } else if (auto identity = dynamic_cast<const NumericIdentityNode*>(node)) {
+        collect_bound_names(identity->op.get(), bound);
+    } else if (auto unary = dynamic_cast<const UnaryOpNode*>(node)) {
+        collect_bound_names(unary->operand.get(), bound);
+    } else if (auto assign = dynamic_cast<const AssignNode*>(node)) {
+        bound.insert(assign->var_name);
+        collect_bound_names(assign->value.get(), bound);
+    } else if (auto assign = dynamic_cast<const IndexAssignNode*>(node)) {
+        collect_bound_names(assign->container.get(), bound);
+        collect_bound_names(assign->index.get(), bound);
+        collect_bound_names(assign->value.get(), bound);
+    } else if (auto print = dynamic_cast<const PrintNode*>(node)) {
+        collect_bound_names(print->expr.get(), bound);
+    } else if (auto ret = dynamic_cast<const ReturnNode*>(node)) {
+        collect_bound_names(ret->expr.get(), bound);
+    } else if (auto yield = dynamic_cast<const YieldNode*>(node)) {
+        collect_bound_names(yield->expr.get(), bound);
+    } else if (auto index = dynamic_cast<const IndexNode*>(node)) {
+        collect_bound_names(index->str.get(), bound);
+        collect_bound_names(index->index.get(), bound);
+    } else if (auto slice = dynamic_cast<const SliceNode*>(node)) {
+        collect_bound_names(slice->str.get(), bound);
+        collect_bound_names(slice->start.get(), bound);
+        collect_bound_names(slice->end.get(), bound);
+    } else if (auto list = dynamic_cast<const ListNode*>(node)) {
+        collect_bound_names(list->elements, bound);
+    } else if (auto map = dynamic_cast<const MapNode*>(node)) {
+        for (const auto& entry : map->entries) {
+            collect_bound_names(entry.first.get(), bound);
+            collect_bound_names(entry.second.get(), bound);
+        }
+    } else if (auto call = dynamic_cast<const CallNode*>(node)) {
+        collect_bound_names(call->callee.get(), bound);
+        collect_bound_names(call->arguments, bound);
+    } else if (auto ifNode = dynamic_cast<const IfNode*>(node)) {
+        for (const auto& branch : ifNode->branches) {
+            collect_bound_names(branch.first.get(), bound);
+            collect_bound_names(branch.second, bound);
+        }
+        collect_bound_names(ifNode->else_branch, bound);
+    } else if (auto forNode = dynamic_cast<const ForNode*>(node)) {
+        bound.insert(forNode->var_name);
+        collect_bound_names(forNode->iterable.get(), bound);
+        collect_bound_names(forNode->body, bound);
+    } else if (auto whileNode = dynamic_cast<const WhileNode*>(node)) {
+        collect_bound_names(whileNode->condition.get(), bound);
+        collect_bound_names(whileNode->body, bound);
+    } else if (auto function = dynamic_cast<const FunctionNode*>(node)) {
+        for (const auto& parameter : function->parameters) bound.insert(parameter);
+        collect_bound_names(function->body, bound);
+    }
+}
+
+void licm_block(std::vector<std::unique_ptr<ASTNode>>& block, const std::unordered_set<std::string>& bound);
+
+// циклы внутри литералов функций
+void licm_functions(ASTNode* node, const std::unordered_set<std::string>& bound) {
+    if (!node) return;
+    if (auto function = dynamic_cast<FunctionNode*>(node)) {
+        licm_block(function->body, bound);
+    } else if (auto binary = dynamic_cast<BinaryOpNode*>(node)) {
+        licm_functions(binary->left.get(), bound);
+        licm_functions(binary->right.get(), bound);
+    } else if (auto unary = dynamic_cast<UnaryOpNode*>(node)) {
+        licm_functions(unary->operand.get(), bound);
+    } else if (auto assign = dynamic_cast<AssignNode*>(node)) {
+        licm_functions(assign->value.get(), bound);
+    } else if (auto assign = dynamic_cast<IndexAssignNode*>(node)) {
+        licm_functions(assign->container.get(), bound);
+        licm_functions(assign->index.get(), bound);
+        licm_functions(assign->value.get(), bound);
+    } else if (auto print = dynamic_cast<PrintNode*>(node)) {
+        licm_functions(print->expr.get(), bound);
+    } else if (auto ret = dynamic_cast<ReturnNode*>(node)) {
+        licm_functions(ret->expr.get(), bound);
+    } else if (auto yield = dynamic_cast<YieldNode*>(node)) {
+        licm_functions(yield->expr.get(), bound);
+    } else if (auto list = dynamic_cast<ListNode*>(node)) {
+        for (auto& element : list->elements) licm_functions(element.get(), bound);
+    } else if (auto map = dynamic_cast<MapNode*>(node)) {
+        for (auto& entry : map->entries) licm_functions(entry.second.get(), bound);
+    } else if (auto call = dynamic_cast<CallNode*>(node)) {
+        licm_functions(call->callee.get(), bound);
+        for (auto& argument : call->arguments) licm_functions(argument.get(), bound);
+    }
+}
+
+// вынос инвариантов идет от внешних циклов к внутренним: внешний забирает все,
+// что не меняется во всем его теле, внутренний - то, что не меняется в нем самом.
+// цикл с yield не выносит ничего: между его итерациями выполняется чужой код, а кэши
+// инвариантов общие для всех генераторов одной функции
+void licm_statement(ASTNode* node, const std::unordered_set<std::string>& bound) {
+    if (auto whileNode = dynamic_cast<WhileNode*>(node)) {
+        if (!whileNode->suspends) {
+            LoopFacts facts{{}, false, &bound};
+            scan(whileNode, facts);
+            hoist_expr(whileNode->condition, facts, whileNode->invariants);
+            hoist_block(whileNode->body, facts, whileNode->invariants);
+        }
+        licm_block(whileNode->body, bound);
+    } else if (auto forNode = dynamic_cast<ForNode*>(node)) {
+        if (!forNode->suspends) {
+            LoopFacts facts{{}, false, &bound};
+            scan(forNode, facts);
+            hoist_block(forNode->body, facts, forNode->invariants);
+        }
+        licm_functions(forNode->iterable.get(), bound);
+        licm_block(forNode->body, bound);
+    } else if (auto ifNode = dynamic_cast<IfNode*>(node)) {
+        for (auto& branch : ifNode->branches) licm_block(branch.second, bound);
+        licm_block(ifNode->else_branch, bound);
+    } else {
+        licm_functions(node, bound);
+    }
+}
+
+void licm_block(std::vector<std::unique_ptr<ASTNode>>& block, const std::unordered_set<std::string>& bound) {
+    for (auto& node : block) licm_statement(node.get(), bound);
+}
+
+std::string op_symbol(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS: return "+";
+        case TokenType::MINUS: return "-";
+        case TokenType::MULTIPLY: return "*";
+        case TokenType::DIVIDE: return "/";
+        case TokenType::MODULO: return "%";
+        case TokenType::POWER: return "^";
+        case TokenType::EQUALS: return "=";
+        case TokenType::PLUS_EQUALS: return "+=";
+        case TokenType::MINUS_EQUALS: return "-=";
+        case TokenType::MULTIPLY_EQUALS: return "*=";
+        case TokenType::DIVIDE_EQUALS: return "/=";
+        case TokenType::MODULO_EQUALS: return "%=";
+        case TokenType::POWER_EQUALS: return "^=";
+        case TokenType::EQUAL_EQUAL: return "==";
+        case TokenType::NOT_EQUAL: return "!=";
+        case TokenType::LESS: return "<";
+        case TokenType::GREATER: return ">";
+        case TokenType::LESS_EQUAL: return "<=";
+        case TokenType::GREATER_EQUAL: return ">=";
+        case TokenType::AND: return "and";
+        case TokenType::OR: return "or";
+        case TokenType::NOT: return "not";
+        case TokenType::IN: return "in";
+        default: return token_type_to_string(op);
+    }
+}
+
+void dump_block(std::ostream& out, const std::vector<std::unique_ptr<ASTNode>>& block, int depth);
+
+// номер ячейки кадра у локальной переменной функции
+std::string slot_suffix(int slot) {
+    return slot < 0 ? "" : " #" + std::to_string(slot);
+}
+
+void dump_node(std::ostream& out, const ASTNode* node, int depth) {
+    std::string indent(depth * 2, ' ');
+    if (!node) {
+        out << indent << "(пусто)\n";
+        return;
+    }
+    if (auto number = dynamic_cast<const NumberNode*>(node)) {
+        out << indent << "Number ";
+        write_value(out, number->value);
+        out << "\n";
+    } else if (auto string = dynamic_cast<const StringNode*>(node)) {
+        out << indent << "String \"" << string->value << "\"\n";
+    } else if (dynamic_cast<const NullNode*>(node)) {
+        out << indent << "Nil\n";
+    } else if (auto variable = dynamic_cast<const VariableNode*>(node)) {
+        out << indent << "Variable " << variable->name << slot_suffix(variable->slot) << "\n";
+    } else if (auto binary = dynamic_cast<const BinaryOpNode*>(node)) {
+        out << indent << "Binary " << op_symbol(binary->op) << "\n";
+        dump_node(out, binary->left.get(), depth + 1);
+        dump_node(out, binary->right.get(), depth + 1);
+    } else if (auto identity = dynamic_cast<const NumericIdentityNode*>(node)) {
+        const BinaryOpNode* op = identity->op.get();
+        out << indent << "NumericIdentity " << op_symbol(op->op) << "\n";
+        dump_node(out, identity->operand_left ? op->left.get() : op->right.get(), depth + 1);
+    } else if (auto invariant = dynamic_cast<const InvariantNode*>(node)) {
+        out << indent << "Invariant\n";
+        dump_node(out, invariant->expr.get(), depth + 1);
+    } else if (auto unary = dynamic_cast<const UnaryOpNode*>(node)) {
+        out << indent << "Unary " << op_symbol(unary->op) << "\n";
+        dump_node(out, unary->operand.get(), depth + 1);
+    } else if (auto assign = dynamic_cast<const AssignNode*>(node)) {
+        out << indent << "Assign " << assign->var_name << slot_suffix(assign->slot) << " " << op_symbol(assign->op) << "\n";
+        dump_node(out, assign->value.get(), depth + 1);
+    } else if (auto assign = dynamic_cast<const IndexAssignNode*>(node)) {
+        out << indent << "IndexAssign " << op_symbol(assign->op) << "\n";
+        dump_node(out, assign->container.get(), depth + 1);
+        dump_node(out, assign->index.get(), depth + 1);
+        dump_node(out, assign->value.get(), depth + 1);
+    } else if (auto print = dynamic_cast<const PrintNode*>(node)) {
+        out << indent << "Print\n";
+        dump_node(out, print->expr.get(), depth + 1);
+    } else if (auto index = dynamic_cast<const IndexNode*>(node)) {
+        out << indent << "Index\n";
+        dump_node(out, index->str.get(), depth + 1);
+        dump_node(out, index->index.get(), depth + 1);
+    } else if (auto slice = dynamic_cast<const SliceNode*>(node)) {
+        out << indent << "Slice\n";
+        dump_node(out, slice->str.get(), depth + 1);
+        dump_node(out, slice->start.get(), depth + 1);
+        dump_node(out, slice->end.get(), depth + 1);
+    } else if (auto list = dynamic_cast<const ListNode*>(node)) {
+        out << indent << "List\n";
+        dump_block(out, list->elements, depth + 1);
+    } else if (auto map = dynamic_cast<const MapNode*>(node)) {
+        out << indent << "Map\n";
+        for (const auto& entry : map->entries) {
+            dump_node(out, entry.first.get(), depth + 1);
+            dump_node(out, entry.second.get(), depth + 2);
+        }
+    } else if (auto call = dynamic_cast<const CallNode*>(node)) {
+        out << indent << "Call\n";
+        dump_node(out, call->callee.get(), depth + 1);
+        dump_block(out, call->arguments, depth + 1);
+    } else if (auto ifNode = dynamic_cast<const IfNode*>(node)) {
+        out << indent << "If\n";
+        for (const auto& branch : ifNode->branches) {
+            out << indent << "  Condition\n";
+            dump_node(out, branch.first.get(), depth + 2);
+            out << indent << "  Then\n";
+            dump_block(out, branch.second, depth + 2);
+        }
+        if (!ifNode->else_branch.empty()) {
+            out << indent << "  Else\n";
+            dump_block(out, ifNode->else_branch, depth + 2);
+        }
+    } else if (auto forNode = dynamic_cast<const ForNode*>(node)) {
+        out << indent << "For " << forNode->var_name << slot_suffix(forNode->slot) << "\n";
+        dump_node(out, forNode->iterable.get(), depth + 1);
+        out << indent << "  Body\n";
+        dump_block(out, forNode->body, depth + 2);
+    } else if (auto whileNode = dynamic_cast<const WhileNode*>(node)) {
+        out << indent << "While\n";
+        dump_node(out, whileNode->condition.get(), depth + 1);
+        out << indent << "  Body\n";
+        dump_block(out, whileNode->body, depth + 2);
+    } else if (dynamic_cast<const BreakNode*>(node)) {
+        out << indent << "Break\n";
+    } else if (dynamic_cast<const ContinueNode*>(node)) {
+        out << indent << "Continue\n";
+    } else if (auto function = dynamic_cast<const FunctionNode*>(node)) {
+        out << indent << "Function(";
+        for (size_t i = 0; i < function->parameters.size(); ++i) {
+            if (i > 0) out << ", ";
+            out << function->parameters[i];
+        }
+        out << ") frame " << function->frame_size << (function->generator ? " generator" : "") << "\n";
+        dump_block(out, function->body, depth + 1);
+    } else if (auto ret = dynamic_cast<const ReturnNode*>(node)) {
+        out << indent << "Return\n";
+        dump_node(out, ret->expr.get(), depth + 1);
+    } else if (auto yield = dynamic_cast<const YieldNode*>(node)) {
+        out << indent << "Yield\n";
+        dump_node(out, yield->expr.get(), depth + 1);
+    } else {
+        out << indent << "?\n";
+    }
+}
+
+void dump_block(std::ostream& out, const std::vector<std::unique_ptr<ASTNode>>& block, int depth) {
+    for (const auto& node : block) dump_node(out, node.get(), depth);
+}
+
+} // namespace
+
+void optimize(std::vector<std::unique_ptr<ASTNode>>& program) {
+    std::unordered_set<std::string> bound_names;
+    optimize(program, bound_names);
+}
+
+void optimize(std::vector<std::unique_ptr<ASTNode>>& program, std::unordered_set<std::string>& bound_names) {
+    optimize_block(program);
+    collect_bound_names(program, bound_names);
+    licm_block(program, bound_names);
+}
+
+void dump_ast(std::ostream& out, const std::vector<std::unique_ptr<ASTNode>>& program) {
+    dump_block(out, program, 0);
+}
@@ -0,0 +1,19 @@
+// оптимизация AST между разбором и выполнением
+#pragma once
+#include "parser/ast.h"
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// свертка константных выражений по правилам apply_binary_op (операция, которая
+// бросает ошибку, остается в дереве и ошибается при выполнении), упрощение
+// x + 0, x * 1 и подобных, удаление ветвей if и циклов while с константным условием,
+// вынос инвариантных подвыражений из тел и условий циклов
+void optimize(std::vector<std::unique_ptr<ASTNode>>& program);
+// bound_names - имена, уже связанные ранее (в сеансе): встроенная функция с таким именем
+// может быть перекрыта пользовательской и не считается чистой; дополняется именами program
+void optimize(std::vector<std::unique_ptr<ASTNode>>& program, std::unordered_set<std::string>& bound_names);
+
+// вывод дерева по одному узлу в строке с отступами по вложенности
+void dump_ast(std::ostream& out, const std::vector<std::unique_ptr<ASTNode>>& program);
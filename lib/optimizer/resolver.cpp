@@ -0,0 +1,127 @@
+#include "resolver.h"
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+using Slots = std::unordered_map<std::string, int>;
+
+void collect_locals(const std::vector<std::unique_ptr<ASTNode>>& block, Slots& slots);
+
+// имена, которым присваивает тело функции; вложенные функции имеют свои кадры
+void collect_locals(const ASTNode* node, Slots& slots) {
+    if (!node) return;
+    auto add = [&](const std::string& name) { slots.try_emplace(name, static_cast<int>(slots.size())); };
+    if (auto assign = dynamic_cast<const AssignNode*>(node)) {
+        add(assign->var_name);
+    } else if (auto ifNode = dynamic_cast<const IfNode*>(node)) {
+        for (const auto& branch : ifNode->branches) collect_locals(branch.second, slots);
+        collect_locals(ifNode->else_branch, slots);
+    } else if (auto forNode = dynamic_cast<const ForNode*>(node)) {
+        add(forNode->var_name);
+        collect_locals(forNode->body, slots);
+    } else if (auto whileNode = dynamic_cast<const WhileNode*>(node)) {
+        collect_locals(whileNode->body, slots);
+    }
+}
+
+void collect_locals(const std::vector<std::unique_ptr<ASTNode>>& block, Slots& slots) {
+    for (const auto& node : block) collect_locals(node.get(), slots);
+}
+
+void resolve(ASTNode* node, const Slots* slots);
+
+void resolve_block(std::vector<std::unique_ptr<ASTNode>>& block, const Slots* slots) {
+    for (auto& node : block) resolve(node.get(), slots);
+}
+
+void resolve_function(FunctionNode* function) {
+    Slots slots;
+    // параметры занимают первые ячейки по порядку; при повторе имени действует последний
+    for (size_t i = 0; i < function->parameters.size(); ++i) slots[function->parameters[i]] = static_cast<int>(i);
+    int next = static_cast<int>(function->parameters.size());
+    Slots assigned;
+    collect_locals(function->body, assigned);
+    std::vector<std::pair<int, std::string>> ordered;
+    for (const auto& [name, order] : assigned) ordered.emplace_back(order, name);
+    std::sort(ordered.begin(), ordered.end());
+    for (const auto& entry : ordered) {
+        if (slots.try_emplace(entry.second, next).second) ++next;
+    }
+    function->frame_size = static_cast<size_t>(next);
+    resolve_block(function->body, &slots);
+}
+
+// slots - локальные переменные объемлющей функции, nullptr на верхнем уровне программы
+void resolve(ASTNode* node, const Slots* slots) {
+    if (!node) return;
+    auto slot_of = [&](const std::string& name) {
+        if (!slots) return -1;
+        auto it = slots->find(name);
+        return it == slots->end() ? -1 : it->second;
+    };
+    if (auto variable = dynamic_cast<VariableNode*>(node)) {
+        variable->slot = slot_of(variable->name);
+    } else if (auto function = dynamic_cast<FunctionNode*>(node)) {
+        resolve_function(function);
+    } else if (auto binary = dynamic_cast<BinaryOpNode*>(node)) {
+        resolve(binary->left.get(), slots);
+        resolve(binary->right.get(), slots);
+    } else if (auto identity = dynamic_cast<NumericIdentityNode*>(node)) {
+        resolve(identity->op.get(), slots);
+    } else if (auto invariant = dynamic_cast<InvariantNode*>(node)) {
+        resolve(invariant->expr.get(), slots);
+    } else if (auto unary = dynamic_cast<UnaryOpNode*>(node)) {
+        resolve(unary->operand.get(), slots);
+    } else if (auto assign = dynamic_cast<AssignNode*>(node)) {
+        assign->slot = slot_of(assign->var_name);
+        resolve(assign->value.get(), slots);
+    } else if (auto assign = dynamic_cast<IndexAssignNode*>(node)) {
+        resolve(assign->container.get(), slots);
+        resolve(assign->index.get(), slots);
+        resolve(assign->value.get(), slots);
+    } else if (auto print = dynamic_cast<PrintNode*>(node)) {
+        resolve(print->expr.get(), slots);
+    } else if (auto ret = dynamic_cast<ReturnNode*>(node)) {
+        resolve(ret->expr.get(), slots);
+    } else if (auto yield = dynamic_cast<YieldNode*>(node)) {
+        resolve(yield->expr.get(), slots);
+    } else if (auto index = dynamic_cast<IndexNode*>(node)) {
+        resolve(index->str.get(), slots);
+        resolve(index->index.get(), slots);
+    } else if (auto slice = dynamic_cast<SliceNode*>(node)) {
+        resolve(slice->str.get(), slots);
+        resolve(slice->start.get(), slots);
+        resolve(slice->end.get(), slots);
+    } else if (auto list = dynamic_cast<ListNode*>(node)) {
+        resolve_block(list->elements, slots);
+    } else if (auto map = dynamic_cast<MapNode*>(node)) {
+        for (auto& entry : map->entries) {
+            resolve(entry.first.get(), slots);
+            resolve(entry.second.get(), slots);
+        }
+    } else if (auto call = dynamic_cast<CallNode*>(node)) {
+        resolve(call->callee.get(), slots);
+        resolve_block(call->arguments, slots);
+    } else if (auto ifNode = dynamic_cast<IfNode*>(node)) {
+        for (auto& branch : ifNode->branches) {
+            resolve(branch.first.get(), slots);
+            resolve_block(branch.second, slots);
+        }
+        resolve_block(ifNode->else_branch, slots);
+    } else if (auto forNode = dynamic_cast<ForNode*>(node)) {
+        forNode->slot = slot_of(forNode->var_name);
+        resolve(forNode->iterable.get(), slots);
+        resolve_block(forNode->body, slots);
+    } else if (auto whileNode = dynamic_cast<WhileNode*>(node)) {
+        resolve(whileNode->condition.get(), slots);
+        resolve_block(whileNode->body, slots);
+    }
+}
+
+} // namespace
+
+void resolve_slots(std::vector<std::unique_ptr<ASTNode>>& program) {
+    resolve_block(program, nullptr);
+}
@@ -0,0 +1,10 @@
+// разметка локальных переменных функций ячейками кадра
+#pragma once
+#include "parser/ast.h"
+#include <vector>
+
+// в каждой функции параметры получают ячейки 0..n-1, а остальные имена, которым функция
+// присваивает (в том числе переменные циклов for), - следующие; чтение и запись этих имен
+// идут через ячейки кадра, прочие имена - глобальные переменные.
+// вызывается после optimize, так как оптимизатор заменяет узлы
+void resolve_slots(std::vector<std::unique_ptr<ASTNode>>& program);
@@ -4,63 +4,107 @@
 #include <vector>
 #include "lexer/lexer.h"
 
+// вид узла: выполнение выбирает ветвь одним switch по виду, а не перебором dynamic_cast
+enum class NodeKind : unsigned char {
+    Number, String, Null, Variable, Binary, NumericIdentity, Unary, Assign, IndexAssign, Print, Index, Slice,
+    List, Map, Call, If, Invariant, For, While, Break, Continue, Function, Return, Yield,
+};
+
 struct ASTNode {
+    const NodeKind kind;
+    bool suspends = false; // инструкция содержит yield: генератор выполняет ее сам и может на ней приостановиться
+    explicit ASTNode(NodeKind k) : kind(k) {}
     virtual ~ASTNode() = default;
 };
 
 struct NumberNode : ASTNode {
     double value;
-    explicit NumberNode(double v) : value(v) {}
+    explicit NumberNode(double v) : ASTNode(NodeKind::Number), value(v) {}
 };
 
 struct StringNode : ASTNode {
     std::string value;
-    explicit StringNode(std::string v) : value(std::move(v)) {}
+    explicit StringNode(std::string v) : ASTNode(NodeKind::String), value(std::move(v)) {}
 };
 
 struct NullNode : ASTNode {
-    NullNode() = default;
+    NullNode() : ASTNode(NodeKind::Null) {}
 };
 
 // узел AST для переменной
 struct VariableNode : ASTNode {
     std::string name;
-    explicit VariableNode(std::string n) : name(std::move(n)) {}
+    int slot = -1; // ячейка кадра для локальной переменной функции, -1 - глобальная переменная
+    explicit VariableNode(std::string n) : ASTNode(NodeKind::Variable), name(std::move(n)) {}
+};
+
+// специализация бинарной операции по типам операндов, которые узел видел при выполнении:
+// операция над двумя числами или двумя строками выполняется без перебора всех типов
+enum class BinaryKind : unsigned char {
+    Unobserved, // узел еще не выполнялся
+    Generic,    // другие типы или типы менялись: общий путь apply_binary_op
+    NumberAdd, NumberSub, NumberMul, NumberDiv, NumberMod, NumberPow,
+    NumberEqual, NumberNotEqual, NumberLess, NumberLessEqual, NumberGreater, NumberGreaterEqual,
+    NumberAnd, NumberOr,
+    StringConcat, StringEqual, StringNotEqual, StringLess, StringLessEqual, StringGreater, StringGreaterEqual,
 };
 
 struct BinaryOpNode : ASTNode {
     TokenType op;
     std::unique_ptr<ASTNode> left;
     std::unique_ptr<ASTNode> right;
+    mutable BinaryKind specialization = BinaryKind::Unobserved; // переписывается при выполнении
     BinaryOpNode(TokenType o, std::unique_ptr<ASTNode> l, std::unique_ptr<ASTNode> r)
-        : op(o), left(std::move(l)), right(std::move(r)) {}
+        : ASTNode(NodeKind::Binary), op(o), left(std::move(l)), right(std::move(r)) {}
+};
+
+// результат оптимизации x op c, где c - нейтральный для чисел элемент (x + 0, x * 1, 1 * x, x ^ 1 ...):
+// число x возвращается как есть, остальные значения вычисляются исходной операцией
+struct NumericIdentityNode : ASTNode {
+    std::unique_ptr<BinaryOpNode> op;
+    bool operand_left; // x - левый операнд op
+    NumericIdentityNode(std::unique_ptr<BinaryOpNode> o, bool left)
+        : ASTNode(NodeKind::NumericIdentity), op(std::move(o)), operand_left(left) {}
 };
 
 struct UnaryOpNode : ASTNode {
     TokenType op;
     std::unique_ptr<ASTNode> operand;
     UnaryOpNode(TokenType o, std::unique_ptr<ASTNode> expr)
-        : op(o), operand(std::move(expr)) {}
+        : ASTNode(NodeKind::Unary), op(o), operand(std::move(expr)) {}
 };
 
 struct AssignNode : ASTNode {
     std::string var_name;
     TokenType op;  // оператор присваивания или составного присваивания
     std::unique_ptr<ASTNode> value;
+    int slot = -1; // ячейка кадра, как у VariableNode
+    mutable BinaryKind specialization = BinaryKind::Unobserved; // специализация составного присваивания, как у BinaryOpNode
     AssignNode(std::string name, TokenType o, std::unique_ptr<ASTNode> v)
-        : var_name(std::move(name)), op(o), value(std::move(v)) {}
+        : ASTNode(NodeKind::Assign), var_name(std::move(name)), op(o), value(std::move(v)) {}
+};
+
+// присваивание элементу: a[i] = v, a[i] op= v; контейнер - любое выражение (grid[r][c] = v)
+struct IndexAssignNode : ASTNode {
+    std::unique_ptr<ASTNode> container;
+    std::unique_ptr<ASTNode> index;
+    TokenType op;  // оператор присваивания или составного присваивания
+    std::unique_ptr<ASTNode> value;
+    mutable BinaryKind specialization = BinaryKind::Unobserved; // как у AssignNode
+    IndexAssignNode(std::unique_ptr<ASTNode> c, std::unique_ptr<ASTNode> i, TokenType o, std::unique_ptr<ASTNode> v)
+        : ASTNode(NodeKind::IndexAssign), container(std::move(c)), index(std::move(i)), op(o), value(std::move(v)) {}
 };
 
 struct PrintNode : ASTNode {
     std::unique_ptr<ASTNode> expr;
-    explicit PrintNode(std::unique_ptr<ASTNode> e) : expr(std::move(e)) {}
+    explicit PrintNode(std::unique_ptr<ASTNode> e) : ASTNode(NodeKind::Print), expr(std::move(e)) {}
 };
 
 struct IndexNode : ASTNode {
     std::unique_ptr<ASTNode> str;
     std::unique_ptr<ASTNode> index;
     IndexNode(std::unique_ptr<ASTNode> s, std::unique_ptr<ASTNode> i)
-        : str(std::move(s)), index(std::move(i)) {}
+        : ASTNode(NodeKind::Index), str(std::move(s)), index(std::move(i)) {}
 };
 
 struct SliceNode : ASTNode {
@@ -68,20 +112,28 @@ struct SliceNode : ASTNode {
     std::unique_ptr<ASTNode> start;  // может быть nullptr для значения по умолчанию
     std::unique_ptr<ASTNode> end;    // может быть nullptr для значения по умолчанию
     SliceNode(std::unique_ptr<ASTNode> s, std::unique_ptr<ASTNode> st, std::unique_ptr<ASTNode> e)
-        : str(std::move(s)), start(std::move(st)), end(std::move(e)) {}
+        : ASTNode(NodeKind::Slice), str(std::move(s)), start(std::move(st)), end(std::move(e)) {}
 };
 
 struct ListNode : ASTNode {
     std::vector<std::unique_ptr<ASTNode>> elements;
-    explicit ListNode(std::vector<std::unique_ptr<ASTNode>> elements) : elements(std::move(elements)) {}
+    explicit ListNode(std::vector<std::unique_ptr<ASTNode>> elements) : ASTNode(NodeKind::List), elements(std::move(elements)) {}
+};
+
+// узел AST для литерала словаря {ключ: значение, ...}
+struct MapNode : ASTNode {
+    std::vector<std::pair<std::unique_ptr<ASTNode>, std::unique_ptr<ASTNode>>> entries;
+    explicit MapNode(std::vector<std::pair<std::unique_ptr<ASTNode>, std::unique_ptr<ASTNode>>> entries)
+        : ASTNode(NodeKind::Map), entries(std::move(entries)) {}
 };
 
 // узел AST для вызовов функций
 struct CallNode : ASTNode {
     std::unique_ptr<ASTNode> callee;
     std::vector<std::unique_ptr<ASTNode>> arguments;
+    int line = 0; // строка вызова для стека вызовов
     CallNode(std::unique_ptr<ASTNode> c, std::vector<std::unique_ptr<ASTNode>> args)
-        : callee(std::move(c)), arguments(std::move(args)) {}
+        : ASTNode(NodeKind::Call), callee(std::move(c)), arguments(std::move(args)) {}
 };
 
 // узел AST для условных операторов (if/else if/else)
@@ -93,42 +145,73 @@ struct IfNode : ASTNode {
     IfNode(
         std::vector<std::pair<std::unique_ptr<ASTNode>, std::vector<std::unique_ptr<ASTNode>>>> b,
         std::vector<std::unique_ptr<ASTNode>> eb)
-        : branches(std::move(b)), else_branch(std::move(eb)) {}
+        : ASTNode(NodeKind::If), branches(std::move(b)), else_branch(std::move(eb)) {}
+};
+
+struct InvariantCache; // значение, вычисленное за текущее выполнение цикла (runtime/types.h)
+
+// инвариантное подвыражение цикла, вынесенное оптимизатором: вычисляется при первом
+// обращении и дальше берется из кэша, пока цикл не завершится
+struct InvariantNode : ASTNode {
+    std::unique_ptr<ASTNode> expr;
+    std::vector<const VariableNode*> inputs; // переменные, которые читает выражение
+    // цикл может изменять списки и словари: значение кэшируется, только если все входы неизменяемы
+    bool immutable_inputs_only;
+    std::shared_ptr<InvariantCache> cache;
+    InvariantNode(std::unique_ptr<ASTNode> e, std::vector<const VariableNode*> in, bool immutable_only,
+                  std::shared_ptr<InvariantCache> c)
+        : ASTNode(NodeKind::Invariant), expr(std::move(e)), inputs(std::move(in)), immutable_inputs_only(immutable_only), cache(std::move(c)) {}
 };
 
 // узел AST для циклов for
 struct ForNode : ASTNode {
     std::string var_name;
+    int slot = -1; // ячейка кадра переменной цикла, как у VariableNode
     std::unique_ptr<ASTNode> iterable;
     std::vector<std::unique_ptr<ASTNode>> body;
+    std::vector<const InvariantNode*> invariants; // кэши, сбрасываемые при входе в цикл
     ForNode(std::string name, std::unique_ptr<ASTNode> it, std::vector<std::unique_ptr<ASTNode>> b)
-        : var_name(std::move(name)), iterable(std::move(it)), body(std::move(b)) {}
+        : ASTNode(NodeKind::For), var_name(std::move(name)), iterable(std::move(it)), body(std::move(b)) {}
 };
 
 // узел AST для циклов while
 struct WhileNode : ASTNode {
     std::unique_ptr<ASTNode> condition;
     std::vector<std::unique_ptr<ASTNode>> body;
+    std::vector<const InvariantNode*> invariants; // кэши, сбрасываемые при входе в цикл
     WhileNode(std::unique_ptr<ASTNode> cond, std::vector<std::unique_ptr<ASTNode>> b)
-        : condition(std::move(cond)), body(std::move(b)) {}
+        : ASTNode(NodeKind::While), condition(std::move(cond)), body(std::move(b)) {}
 };
 
 // узел AST для break
-struct BreakNode : ASTNode {};
+struct BreakNode : ASTNode {
+    BreakNode() : ASTNode(NodeKind::Break) {}
+};
 
 // узел AST для continue
-struct ContinueNode : ASTNode {};
+struct ContinueNode : ASTNode {
+    ContinueNode() : ASTNode(NodeKind::Continue) {}
+};
 
 // узел AST для функциональных литералов
 struct FunctionNode : ASTNode {
     std::vector<std::string> parameters;
     std::vector<std::unique_ptr<ASTNode>> body;
+    size_t frame_size = 0; // число ячеек кадра: параметры, затем остальные локальные переменные
+    std::string name;      // имя переменной, которой функция присвоена при определении (name = function ...)
+    bool generator = false; // тело содержит yield: вызов возвращает итератор
     FunctionNode(std::vector<std::string> params, std::vector<std::unique_ptr<ASTNode>> b)
-        : parameters(std::move(params)), body(std::move(b)) {}
+        : ASTNode(NodeKind::Function), parameters(std::move(params)), body(std::move(b)) {}
 };
 
 // узел AST для операторов return
 struct ReturnNode : ASTNode {
     std::unique_ptr<ASTNode> expr;
-    explicit ReturnNode(std::unique_ptr<ASTNode> e) : expr(std::move(e)) {}
+    explicit ReturnNode(std::unique_ptr<ASTNode> e) : ASTNode(NodeKind::Return), expr(std::move(e)) {}
+};
+
+// узел AST для операторов yield: очередной элемент генератора
+struct YieldNode : ASTNode {
+    std::unique_ptr<ASTNode> expr;
+    explicit YieldNode(std::unique_ptr<ASTNode> e) : ASTNode(NodeKind::Yield), expr(std::move(e)) { suspends = true; }
 };
\ No newline at end of file
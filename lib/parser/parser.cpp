@@ -1,4 +1,10 @@
 #include "parser.h"
+#include <algorithm>
+
+// блок содержит yield на любой глубине условий и циклов (вложенные функции - отдельные генераторы)
+static bool suspends(const std::vector<std::unique_ptr<ASTNode>>& block) {
+    return std::any_of(block.begin(), block.end(), [](const auto& statement) { return statement->suspends; });
+}
 
 Parser::Parser(Lexer& l) : lexer_(l) {
     current_token_ = lexer_.next_token();
@@ -7,13 +13,26 @@ Parser::Parser(Lexer& l) : lexer_(l) {
 std::vector<std::unique_ptr<ASTNode>> Parser::parse() {
     std::vector<std::unique_ptr<ASTNode>> statements; // собрать все statements в вектор указателей на узлы АСТ
     
-    while (current_token_.type != TokenType::END_OF_FILE) {
-        statements.push_back(parse_statement());
+    while (auto statement = parse_next()) {
+        statements.push_back(std::move(statement));
     }
     
     return statements;
 }
 
+std::unique_ptr<ASTNode> Parser::parse_next() {
+    if (current_token_.type == TokenType::END_OF_FILE) return nullptr;
+    try {
+        return parse_statement();
+    } catch (const IncompleteInputError&) {
+        throw;
+    } catch (const std::runtime_error& e) {
+        // инструкция оборвалась на конце ввода, а не на неверном токене
+        if (current_token_.type == TokenType::END_OF_FILE) throw IncompleteInputError(e.what());
+        throw;
+    }
+}
+
 void Parser::next_token() {
     current_token_ = lexer_.next_token();
 }
@@ -25,6 +44,13 @@ std::unique_ptr<ASTNode> Parser::parse_statement() {
         auto expr = parse_expression();
         return std::make_unique<ReturnNode>(std::move(expr));
     }
+    // оператор yield
+    if (current_token_.type == TokenType::YIELD) {
+        if (function_depth_ == 0) throw std::runtime_error("yield вне функции");
+        next_token();
+        auto expr = parse_expression();
+        return std::make_unique<YieldNode>(std::move(expr));
+    }
     // оператор print
     if (current_token_.type == TokenType::PRINT) {
         next_token();  // пропустить 'print'
@@ -73,7 +99,10 @@ std::unique_ptr<ASTNode> Parser::parse_statement() {
         next_token();  // пропустить 'end'
         if (current_token_.type != TokenType::IF) throw std::runtime_error("ожидалось 'if' после end");
         next_token();  // пропустить 'if'
-        return std::make_unique<IfNode>(std::move(branches), std::move(else_block));
+        auto node = std::make_unique<IfNode>(std::move(branches), std::move(else_block));
+        node->suspends = suspends(node->else_branch) ||
+                         std::any_of(node->branches.begin(), node->branches.end(), [](const auto& branch) { return suspends(branch.second); });
+        return node;
     }
     // цикл for
     if (current_token_.type == TokenType::FOR) {
@@ -92,7 +121,9 @@ std::unique_ptr<ASTNode> Parser::parse_statement() {
         next_token();  // пропустить 'end'
         if (current_token_.type != TokenType::FOR) throw std::runtime_error("ожидалось 'for' после end");
         next_token();  // пропустить 'for'
-        return std::make_unique<ForNode>(std::move(var_name), std::move(iterable), std::move(body));
+        auto node = std::make_unique<ForNode>(std::move(var_name), std::move(iterable), std::move(body));
+        node->suspends = suspends(node->body);
+        return node;
     }
     // цикл while
     if (current_token_.type == TokenType::WHILE) {
@@ -106,7 +137,9 @@ std::unique_ptr<ASTNode> Parser::parse_statement() {
         next_token();  // пропустить 'end'
         if (current_token_.type != TokenType::WHILE) throw std::runtime_error("ожидалось 'while' после end");
         next_token();  // пропустить 'while'
-        return std::make_unique<WhileNode>(std::move(condition), std::move(body));
+        auto node = std::make_unique<WhileNode>(std::move(condition), std::move(body));
+        node->suspends = suspends(node->body);
+        return node;
     }
     // оператор break
     if (current_token_.type == TokenType::BREAK) {
@@ -141,8 +174,17 @@ std::unique_ptr<ASTNode> Parser::parse_assignment() {
             auto op = current_token_.type;
             next_token();
             auto value = parse_assignment();
+            if (auto function = dynamic_cast<FunctionNode*>(value.get()); function && function->name.empty()) {
+                function->name = var->name;
+            }
             return std::make_unique<AssignNode>(var->name, op, std::move(value));
         }
+        if (auto index = dynamic_cast<IndexNode*>(expr.get())) {
+            auto op = current_token_.type;
+            next_token();
+            auto value = parse_assignment();
+            return std::make_unique<IndexAssignNode>(std::move(index->str), std::move(index->index), op, std::move(value));
+        }
         throw std::runtime_error("недопустимая цель присваивания");
     }
     
@@ -195,7 +237,8 @@ std::unique_ptr<ASTNode> Parser::parse_comparison() {
     while (current_token_.type == TokenType::LESS ||
            current_token_.type == TokenType::GREATER ||
            current_token_.type == TokenType::LESS_EQUAL ||
-           current_token_.type == TokenType::GREATER_EQUAL) {
+           current_token_.type == TokenType::GREATER_EQUAL ||
+           current_token_.type == TokenType::IN) {
         auto op = current_token_.type;
         next_token();
         auto right = parse_term();
@@ -265,6 +308,7 @@ std::unique_ptr<ASTNode> Parser::parse_primary() {
     
     // обработка вызовов функций
     while (current_token_.type == TokenType::LEFT_PAREN) {
+        int line = current_token_.line;
         next_token();  // пропустить '('
         std::vector<std::unique_ptr<ASTNode>> args;
         if (current_token_.type != TokenType::RIGHT_PAREN) {
@@ -276,7 +320,9 @@ std::unique_ptr<ASTNode> Parser::parse_primary() {
         }
         if (current_token_.type != TokenType::RIGHT_PAREN) throw std::runtime_error("ожидалась ')' после аргументов функции");
         next_token();  // пропустить ')'
-        expr = std::make_unique<CallNode>(std::move(expr), std::move(args));
+        auto callNode = std::make_unique<CallNode>(std::move(expr), std::move(args));
+        callNode->line = line;
+        expr = std::move(callNode);
     }
     
     while (current_token_.type == TokenType::LEFT_BRACKET) {
@@ -321,6 +367,7 @@ std::unique_ptr<ASTNode> Parser::parse_primary() {
     
     // обработка вызовов функций после индексации/среза (например, funcs[0]())
     while (current_token_.type == TokenType::LEFT_PAREN) {
+        int line = current_token_.line;
         next_token();  // пропустить '('
         std::vector<std::unique_ptr<ASTNode>> args;
         if (current_token_.type != TokenType::RIGHT_PAREN) {
@@ -332,7 +379,9 @@ std::unique_ptr<ASTNode> Parser::parse_primary() {
         }
         if (current_token_.type != TokenType::RIGHT_PAREN) throw std::runtime_error("ожидалась ')' после аргументов функции");
         next_token();  // пропустить ')'
-        expr = std::make_unique<CallNode>(std::move(expr), std::move(args));
+        auto callNode = std::make_unique<CallNode>(std::move(expr), std::move(args));
+        callNode->line = line;
+        expr = std::move(callNode);
     }
     
     return expr;
@@ -357,13 +406,17 @@ std::unique_ptr<ASTNode> Parser::parse_atom() {
         next_token(); // пропустить ')'
         // разбор тела функции
         std::vector<std::unique_ptr<ASTNode>> body;
+        ++function_depth_;
         while (current_token_.type != TokenType::END) {
             body.push_back(parse_statement());
         }
+        --function_depth_;
         next_token(); // пропустить 'end'
         if (current_token_.type != TokenType::FUNCTION) throw std::runtime_error("ожидалось 'function' после end");
         next_token(); // пропустить 'function'
-        return std::make_unique<FunctionNode>(std::move(params), std::move(body));
+        auto node = std::make_unique<FunctionNode>(std::move(params), std::move(body));
+        node->generator = suspends(node->body);
+        return node;
     }
     if (current_token_.type == TokenType::NUMBER) {
         auto node = std::make_unique<NumberNode>(current_token_.number_value);
@@ -414,6 +467,10 @@ std::unique_ptr<ASTNode> Parser::parse_atom() {
         return parse_list();
     }
 
+    if (current_token_.type == TokenType::LEFT_BRACE) {
+        return parse_map();
+    }
+
     throw std::runtime_error("ожидалось число, строка, идентификатор или '('");
 }
 
@@ -437,4 +494,32 @@ std::unique_ptr<ASTNode> Parser::parse_list() {
     }
     next_token();  // пропустить ']'
     return std::make_unique<ListNode>(std::move(elements));
+}
+
+std::unique_ptr<ASTNode> Parser::parse_map() {
+    next_token();  // пропустить '{'
+    std::vector<std::pair<std::unique_ptr<ASTNode>, std::unique_ptr<ASTNode>>> entries;
+
+    // разбор пар ключ: значение, разрешая завершающую запятую
+    while (current_token_.type != TokenType::RIGHT_BRACE) {
+        auto key = parse_expression();
+        if (current_token_.type != TokenType::COLON) {
+            throw std::runtime_error("ожидалось ':' после ключа словаря");
+        }
+        next_token();  // пропустить ':'
+        auto value = parse_expression();
+        entries.emplace_back(std::move(key), std::move(value));
+        if (current_token_.type == TokenType::COMMA) {
+            next_token();  // пропустить запятую
+            continue;
+        } else {
+            break;
+        }
+    }
+
+    if (current_token_.type != TokenType::RIGHT_BRACE) {
+        throw std::runtime_error("ожидалась '}'");
+    }
+    next_token();  // пропустить '}'
+    return std::make_unique<MapNode>(std::move(entries));
 }
\ No newline at end of file
@@ -8,10 +8,14 @@ class Parser {
 public:
     explicit Parser(Lexer& l);
     std::vector<std::unique_ptr<ASTNode>> parse();
+    // следующая инструкция (вместе с вложенным блоком) или nullptr в конце ввода;
+    // ошибка на конце ввода сообщается как IncompleteInputError
+    std::unique_ptr<ASTNode> parse_next();
 
 private:
     Lexer& lexer_;
     Token current_token_;
+    int function_depth_ = 0; // вложенность разбираемых литералов функций: yield допустим только в них
 
     void next_token();
     std::unique_ptr<ASTNode> parse_statement();
@@ -28,4 +32,5 @@ private:
     std::unique_ptr<ASTNode> parse_primary();
     std::unique_ptr<ASTNode> parse_atom();
     std::unique_ptr<ASTNode> parse_list();
+    std::unique_ptr<ASTNode> parse_map();
 };
\ No newline at end of file
@@ -3,20 +3,55 @@
 #include <unordered_map>
 #include <stdexcept>
 
+// значение незаполненной ячейки кадра: пустой указатель на функцию (функции языка всегда непусты)
+inline Value unbound_value() { return Function(); }
+
+inline bool is_unbound(const Value& v) {
+    auto f = std::get_if<Function>(&v);
+    return f && !*f;
+}
+
 class Environment { // среда выполнения которая хранит переменные, их значения, обеспечивает к переменным доступ по имени, управляет областью видимости
 public:
+    Environment() = default; // глобальная среда
+
+    // кадр вызова функции: локальные переменные лежат в ячейках slots (их номера проставлены
+    // в узлах AST), а имена без ячейки ищутся в глобальной среде
+    Environment(Value* slots, Environment& globals) : slots_(slots), globals_(&globals) {}
+
     void set(const std::string& name, const Value& value) { // переменная
-        variables_[name] = value;
+        globals().variables_[name] = value;
+    }
+
+    bool has(const std::string& name) const { // определена ли переменная
+        return globals().variables_.count(name) != 0;
     }
 
     Value get(const std::string& name) const { // получение значения переменной
-        auto it = variables_.find(name);
-        if (it == variables_.end()) {
+        const auto& variables = globals().variables_;
+        auto it = variables.find(name);
+        if (it == variables.end()) {
             throw std::runtime_error("Неопределенная переменная: " + name);
         }
         return it->second;
     }
 
+    Value& variable(const std::string& name) { // существующая глобальная переменная для изменения на месте
+        auto& variables = globals().variables_;
+        auto it = variables.find(name);
+        if (it == variables.end()) {
+            throw std::runtime_error("Неопределенная переменная: " + name);
+        }
+        return it->second;
+    }
+
+    Value& slot(int index) { return slots_[index]; } // ячейка локальной переменной кадра
+
+    Environment& globals() { return globals_ ? *globals_ : *this; }
+    const Environment& globals() const { return globals_ ? *globals_ : *this; }
+
 private:
     std::unordered_map<std::string, Value> variables_; // хт с именем переменной - значением
-};
\ No newline at end of file
+    Value* slots_ = nullptr;
+    Environment* globals_ = nullptr;
+};
@@ -1,553 +1,1674 @@
 #include "evaluator.h"
 #include "operations.h"
 #include "utils.h"
+#include "string_kernels.h"
+#include "numeric_kernels.h"
+#include "sorting.h"
+#include "line_reader.h"
+#include "file_io.h"
 #include <stdexcept>
+#include <sstream>
 #include <algorithm>
 #include <cstdlib>
 #include <cmath>
+#include <cstdint>
+#include <optional>
+#include <atomic>
 
-std::vector<Value>* g_print_values = nullptr; // глобальный указатель для хранения значений для печати
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 
-Value evaluate(const ASTNode* node, Environment& env) { // вычисляет значение узла AST и возвращает результат типа Value
-    // обработка функции
-    if (auto fnNode = dynamic_cast<const FunctionNode*>(node)) {
-        auto fval = std::make_shared<FunctionValue>();
-        fval->parameters = fnNode->parameters;
-        for (const auto& stmt : fnNode->body) {
-            fval->body.push_back(stmt.get());
+thread_local std::vector<Value>* g_print_values = nullptr; // указатель для хранения значений для печати
+
+// числа списка или массива: упакованный список и массив отдаются без копирования,
+// смешанный список распаковывается в buffer
+static const double* numbers_of(const Value& v, size_t& n, std::vector<double>& buffer, const std::string& name) {
+    if (std::holds_alternative<Array>(v)) {
+        const auto& data = std::get<Array>(v)->data;
+        n = data.size();
+        return data.data();
+    }
+    if (!std::holds_alternative<List>(v)) throw std::runtime_error("Аргумент " + name + "() должен быть списком или массивом");
+    const List& lst = std::get<List>(v);
+    n = lst->size();
+    if (lst->packed()) return lst->numbers();
+    buffer.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Value elem = lst->get(i);
+        if (!std::holds_alternative<double>(elem)) throw std::runtime_error("Элементы списка " + name + "() должны быть числами");
+        buffer.push_back(std::get<double>(elem));
+    }
+    return buffer.data();
+}
+
+// стек значений для кадров вызовов: сегменты выделяются один раз и переиспользуются
+// следующими вызовами, кадр - непрерывный участок одного сегмента, поэтому указатели
+// на ячейки не меняются, пока кадр жив
+class ValueStack {
+public:
+    struct Mark {
+        size_t segment;
+        size_t top;
+    };
+
+    Mark mark() const { return {segment_, top_}; }
+
+    Value* push(size_t n) {
+        while (segment_ < segments_.size() && top_ + n > segments_[segment_].size) {
+            ++segment_;
+            top_ = 0;
+        }
+        if (segment_ == segments_.size()) {
+            size_t size = std::max(kSegmentSize, n);
+            Segment segment{std::make_unique<Value[]>(size), size};
+            std::fill(segment.data.get(), segment.data.get() + size, unbound_value());
+            segments_.push_back(std::move(segment));
+            top_ = 0;
         }
-        return fval;
+        Value* base = segments_[segment_].data.get() + top_;
+        top_ += n;
+        return base;
     }
-    // возврат null
-    if (auto nullNode = dynamic_cast<const NullNode*>(node)) {
-        return NullType{};
+
+    // ячейки кадра очищаются (освобождая значения) и возвращаются в стек
+    void release(Mark mark, Value* base, size_t n) {
+        for (size_t i = 0; i < n; ++i) base[i] = unbound_value();
+        segment_ = mark.segment;
+        top_ = mark.top;
     }
-    // возврат числа
-    if (auto num = dynamic_cast<const NumberNode*>(node)) {
-        return num->value;
-    }
-    // возврат строки
-    if (auto str = dynamic_cast<const StringNode*>(node)) {
-        return str->value;
-    }
-    // обработка вызова функции
-    if (auto call = dynamic_cast<const CallNode*>(node)) {
-        if (auto fn = dynamic_cast<const VariableNode*>(call->callee.get())) {
-            const std::string& name = fn->name;
-            // функция len
-            if (name == "len" && call->arguments.size() == 1) {
-                auto val = evaluate(call->arguments[0].get(), env);
-                if (std::holds_alternative<std::string>(val)) {
-                    return static_cast<double>(std::get<std::string>(val).size());
-                } else if (std::holds_alternative<List>(val)) {
-                    return static_cast<double>(std::get<List>(val)->elements.size());
-                }
-                throw std::runtime_error("Аргумент len() должен быть строкой или списком");
-            }
-            // функция range
-            if (name == "range") {
-                size_t argc = call->arguments.size();
-                if (argc == 1) {
-                    auto endVal = evaluate(call->arguments[0].get(), env);
-                    if (!std::holds_alternative<double>(endVal)) throw std::runtime_error("Аргумент range() должен быть числом");
-                    double end = std::get<double>(endVal);
-                    auto result = std::make_shared<ListValue>();
-                    for (double v = 0; v < end; v += 1) result->elements.push_back(v);
-                    return result;
-                } else if (argc == 2) {
-                    auto startVal = evaluate(call->arguments[0].get(), env);
-                    auto endVal = evaluate(call->arguments[1].get(), env);
-                    if (!std::holds_alternative<double>(startVal) || !std::holds_alternative<double>(endVal)) throw std::runtime_error("Аргументы range() должны быть числами");
-                    double start = std::get<double>(startVal);
-                    double end = std::get<double>(endVal);
-                    auto result = std::make_shared<ListValue>();
-                    for (double v = start; v < end; v += 1) result->elements.push_back(v);
-                    return result;
-                } else if (argc == 3) {
-                    auto startVal = evaluate(call->arguments[0].get(), env);
-                    auto endVal = evaluate(call->arguments[1].get(), env);
-                    auto stepVal = evaluate(call->arguments[2].get(), env);
-                    if (!std::holds_alternative<double>(startVal) || !std::holds_alternative<double>(endVal) || !std::holds_alternative<double>(stepVal)) throw std::runtime_error("Аргументы range() должны быть числами");
-                    double start = std::get<double>(startVal);
-                    double end = std::get<double>(endVal);
-                    double step = std::get<double>(stepVal);
-                    auto result = std::make_shared<ListValue>();
-                    if (step == 0) throw std::runtime_error("Шаг range() не может быть нулевым");
-                    if (step > 0) {
-                        for (double v = start; v < end; v += step) result->elements.push_back(v);
-                    } else {
-                        for (double v = start; v > end; v += step) result->elements.push_back(v);
-                    }
-                    return result;
-                }
-                throw std::runtime_error("range() ожидает 1, 2 или 3 аргумента");
+
+private:
+    static constexpr size_t kSegmentSize = 4096;
+    struct Segment {
+        std::unique_ptr<Value[]> data;
+        size_t size;
+    };
+    std::vector<Segment> segments_;
+    size_t segment_ = 0;
+    size_t top_ = 0;
+};
+
+// стеки и отложенный вызов - свои у каждого потока: интерпретаторы в разных потоках независимы
+static thread_local ValueStack g_value_stack;
+
+// кадр вызова на стеке значений на время жизни объекта
+class CallFrame {
+public:
+    explicit CallFrame(size_t size) : mark_(g_value_stack.mark()), size_(size), slots_(g_value_stack.push(size)) {}
+    ~CallFrame() { g_value_stack.release(mark_, slots_, size_); }
+    CallFrame(const CallFrame&) = delete;
+    CallFrame& operator=(const CallFrame&) = delete;
+
+    Value* slots() const { return slots_; }
+
+    // кадр заменяется кадром другого размера на том же месте стека (для хвостового вызова);
+    // все кадры, лежавшие выше, к этому моменту уже освобождены
+    void reset(size_t size) {
+        g_value_stack.release(mark_, slots_, size_);
+        size_ = size;
+        slots_ = g_value_stack.push(size);
+    }
+
+private:
+    ValueStack::Mark mark_;
+    size_t size_;
+    Value* slots_;
+};
+
+// запись теневого стека вызовов: функция и строка, откуда она вызвана (0 - из встроенной функции)
+struct CallRecord {
+    const FunctionNode* function;
+    int line;
+};
+
+static std::atomic<size_t> g_call_depth_limit = 5000; // общий для всех потоков (set_max_call_depth)
+
+// теневой стек вызовов пользовательских функций: источник stacktrace() и стека в сообщениях
+// об ошибках. глубина ограничена числом вызовов и объемом занятого стека C++, чтобы глубокая
+// рекурсия завершалась ошибкой, а не переполнением стека
+class CallStack {
+public:
+    void push(const FunctionNode* function, int line) {
+        char marker;
+        auto here = reinterpret_cast<std::uintptr_t>(&marker);
+        if (records_.empty()) base_ = here;
+        std::uintptr_t used = base_ > here ? base_ - here : here - base_;
+        if (records_.size() >= g_call_depth_limit.load(std::memory_order_relaxed) || used > native_budget_) {
+            throw std::runtime_error("Превышена максимальная глубина рекурсии (" + std::to_string(records_.size()) + ")");
+        }
+        records_.push_back({function, line});
+    }
+    void pop() { records_.pop_back(); }
+    CallRecord& top() { return records_.back(); }
+    const std::vector<CallRecord>& records() const { return records_; }
+
+    CallStack() : native_budget_(native_stack_budget()) {
+        // без перевыделений в пределах обычной глубины
+        records_.reserve(std::min<size_t>(g_call_depth_limit.load(std::memory_order_relaxed), 1 << 16));
+    }
+
+private:
+    // сколько стека C++ могут занять вложенные вызовы: размер стека за вычетом запаса
+    // на встроенные функции и обработку ошибки
+    static std::uintptr_t native_stack_budget() {
+        constexpr std::uintptr_t kReserve = 1 << 20;
+        std::uintptr_t size = 1 << 20; // стек потока по умолчанию в Windows
+#if defined(__unix__) || defined(__APPLE__)
+        rlimit limit{};
+        if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) size = limit.rlim_cur;
+        else size = std::uintptr_t(8) << 20;
+#endif
+        return size > 2 * kReserve ? size - kReserve : size / 2;
+    }
+
+    std::vector<CallRecord> records_;
+    std::uintptr_t base_ = 0;
+    std::uintptr_t native_budget_;
+};
+
+static thread_local CallStack g_call_stack;
+
+void set_call_depth_limit(size_t depth) {
+    g_call_depth_limit.store(depth, std::memory_order_relaxed);
+}
+
+// запись в теневом стеке на время вызова
+class CallRecordGuard {
+public:
+    CallRecordGuard(const FunctionNode* function, int line) { g_call_stack.push(function, line); }
+    ~CallRecordGuard() { g_call_stack.pop(); }
+    CallRecordGuard(const CallRecordGuard&) = delete;
+    CallRecordGuard& operator=(const CallRecordGuard&) = delete;
+};
+
+static std::string describe_call(const CallRecord& record) {
+    std::string name = record.function && !record.function->name.empty() ? record.function->name : "<анонимная функция>";
+    if (record.line > 0) name += " (строка " + std::to_string(record.line) + ")";
+    return name;
+}
+
+// стек вызовов для сообщения об ошибке, от внешнего вызова к внутреннему; середина длинного стека опускается
+static std::string format_call_stack() {
+    constexpr size_t kShown = 5;
+    const auto& records = g_call_stack.records();
+    std::string result = "\nСтек вызовов: ";
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (records.size() > 2 * kShown && i == kShown) {
+            result += " -> ... (" + std::to_string(records.size() - 2 * kShown) + ")";
+            i = records.size() - kShown;
+        }
+        if (i > 0) result += " -> ";
+        result += describe_call(records[i]);
+    }
+    return result;
+}
+
+// ошибка, к которой уже приписан стек вызовов: внешние вызовы передают ее дальше без изменений
+struct TracedError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// как продолжается выполнение после инструкции
+enum class Flow {
+    Normal,
+    Break,
+    Continue,
+    Return,  // значение - в returned
+    TailCall // return f(...) пользовательской функции: вызов в g_tail_call, выполняется в кадре вызывающего
+};
+
+// отложенный хвостовой вызов: run_function выполняет его в своем кадре вместо вложенного вызова
+struct TailCall {
+    Function function;
+    std::vector<Value> args; // емкость переиспользуется между вызовами
+    int line = 0;
+};
+
+static thread_local TailCall g_tail_call;
+
+static Flow exec_statement(const ASTNode* node, Environment& env, std::vector<Value>& print_values, Value& returned);
+static Value make_generator(const Function& f, Value* args, Environment& env);
+
+static size_t frame_size(const FunctionValue& f) {
+    return std::max(f.frame_size, f.parameters.size());
+}
+
+// выполнение тела функции в кадре, ячейки параметров которого уже заполнены;
+// хвостовые вызовы выполняются здесь же в цикле, не углубляя стек C++
+static Value run_function(const FunctionValue* f, CallFrame& frame, Environment& env) {
+    Function tail_function; // держит функцию хвостового вызова, пока выполняется ее тело
+    Value returned;
+    while (true) {
+        Environment local(frame.slots(), env.globals());
+        Flow flow = Flow::Normal;
+        for (const auto* stmt : f->body) {
+            flow = exec_statement(stmt, local, *g_print_values, returned);
+            if (flow != Flow::Normal) break;
+        }
+        switch (flow) {
+            case Flow::Normal: return NullType{};
+            case Flow::Return: return returned;
+            case Flow::Break: throw std::runtime_error("break вне цикла");
+            case Flow::Continue: throw std::runtime_error("continue вне цикла");
+            case Flow::TailCall: break;
+        }
+        tail_function = std::move(g_tail_call.function);
+        f = tail_function.get();
+        g_call_stack.top() = {f->node, g_tail_call.line}; // хвостовой вызов замещает запись вызывающего
+        frame.reset(frame_size(*f));
+        for (size_t i = 0; i < g_tail_call.args.size(); ++i) frame.slots()[i] = std::move(g_tail_call.args[i]);
+        g_tail_call.args.clear();
+        if (f->node->generator) return make_generator(tail_function, frame.slots(), env);
+    }
+}
+
+// вызов с записью в теневом стеке; ошибка, вышедшая из самого глубокого вызова,
+// получает стек вызовов на момент ошибки
+static Value invoke(const Function& f, CallFrame& frame, Environment& env, int line) {
+    if (f->node->generator) return make_generator(f, frame.slots(), env); // тело выполнится при обходе
+    CallRecordGuard record(f->node, line);
+    try {
+        return run_function(f.get(), frame, env);
+    } catch (const TracedError&) {
+        throw;
+    } catch (const std::runtime_error& e) {
+        throw TracedError(e.what() + format_call_stack());
+    }
+}
+
+Value call_function(const Function& f, std::vector<Value> args, Environment& env) {
+    CallFrame frame(frame_size(*f));
+    for (size_t i = 0; i < f->parameters.size(); ++i) frame.slots()[i] = std::move(args[i]);
+    return invoke(f, frame, env, 0);
+}
+
+// проверка вида узла без dynamic_cast: nullptr, если узел другого вида
+static const VariableNode* as_variable(const ASTNode* node) {
+    return node->kind == NodeKind::Variable ? static_cast<const VariableNode*>(node) : nullptr;
+}
+
+static const CallNode* as_call(const ASTNode* node) {
+    return node->kind == NodeKind::Call ? static_cast<const CallNode*>(node) : nullptr;
+}
+
+// чтение переменной: локальная - из ячейки кадра, остальные - из глобальной среды
+static Value read_variable(const VariableNode* var, Environment& env) {
+    if (var->slot < 0) return env.get(var->name);
+    const Value& value = env.slot(var->slot);
+    if (is_unbound(value)) throw std::runtime_error("Неопределенная переменная: " + var->name);
+    return value;
+}
+
+static void write_variable(int slot, const std::string& name, Value value, Environment& env) {
+    if (slot < 0) {
+        env.set(name, std::move(value));
+    } else {
+        env.slot(slot) = std::move(value);
+    }
+}
+
+// s += x, s *= n, l += [...], l *= n без нового значения. строка дописывается в собственный
+// буфер (пока на него не ссылаются другие строки), а список меняется, как push, вместе
+// со всеми ссылками на него; замороженный список и остальные случаи - общий путь
+static bool compound_assign_in_place(Value& target, const Value& value, TokenType op) {
+    if (auto str = std::get_if<Str>(&target)) {
+        if (op == TokenType::PLUS) {
+            if (auto tail = std::get_if<Str>(&value)) {
+                str->append(tail->view());
+                return true;
             }
-            if (name == "read" && call->arguments.empty()) {
-                return std::string();
+            if (auto num = std::get_if<double>(&value)) {
+                str->append(format_number(*num));
+                return true;
             }
-            if (name == "stacktrace" && call->arguments.empty()) {
-                auto result = std::make_shared<ListValue>();
-                return result;
+        } else if (op == TokenType::MULTIPLY) {
+            int64_t times;
+            auto count = std::get_if<double>(&value);
+            if (count && exact_int64(*count, times) && times > 0) {
+                str->repeat(static_cast<size_t>(times));
+                return true;
             }
-            // математические функции
-            if (name == "abs" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент abs() должен быть числом");
-                return std::fabs(std::get<double>(v));
+        }
+        return false;
+    }
+    if (auto list = std::get_if<List>(&target)) {
+        if ((*list)->frozen()) return false;
+        if (op == TokenType::PLUS) {
+            if (auto other = std::get_if<List>(&value)) {
+                (*list)->append(**other);
+                return true;
             }
-            if (name == "ceil" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент ceil() должен быть числом");
-                return std::ceil(std::get<double>(v));
+        } else if (op == TokenType::MULTIPLY) {
+            if (auto count = std::get_if<double>(&value)) {
+                (*list)->repeat(*count > 0 ? static_cast<size_t>(to_index(*count)) : 0);
+                return true;
             }
-            if (name == "floor" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент floor() должен быть числом");
-                return std::floor(std::get<double>(v));
+        }
+    }
+    return false;
+}
+
+// элемент a[i] = v и a[i] op= v: отрицательный индекс отсчитывается от конца, как при
+// чтении, но выход за границы - ошибка. элемент меняется на месте вместе со всеми
+// ссылками на контейнер; составное присваивание - как у переменной
+static Value assign_element(const IndexAssignNode* assign, const Value& container, const Value& key, Value value) {
+    bool compound = assign->op != TokenType::EQUALS;
+    TokenType op = compound ? get_binary_op_from_compound_assign(assign->op) : assign->op;
+    auto update = [&](Value& element) -> Value {
+        if (!compound) {
+            element = std::move(value);
+        } else if (std::holds_alternative<double>(element) || !compound_assign_in_place(element, value, op)) {
+            element = apply_binary_op(assign->specialization, std::move(element), std::move(value), op);
+        }
+        return element;
+    };
+    if (auto map = std::get_if<Map>(&container)) {
+        if (!is_hashable(key)) throw std::runtime_error("Ключ словаря должен быть числом или строкой");
+        auto& table = (*map)->table;
+        if (!compound) return update(*table.try_emplace(key).first);
+        Value* element = table.find(key);
+        if (!element) throw std::runtime_error("Составное присваивание отсутствующему ключу словаря");
+        return update(*element);
+    }
+    if (std::holds_alternative<Str>(container)) throw std::runtime_error("Строки неизменяемы: присваивание по индексу невозможно");
+    if (!std::holds_alternative<List>(container) && !std::holds_alternative<Array>(container)) {
+        throw std::runtime_error("Присваивание по индексу требует список, массив или словарь");
+    }
+    if (!std::holds_alternative<double>(key)) throw std::runtime_error("Индекс должен быть числом");
+    int64_t idx = to_index(std::get<double>(key));
+    if (auto list = std::get_if<List>(&container)) {
+        ListValue& items = **list;
+        int64_t len = static_cast<int64_t>(items.size());
+        if (idx < 0) idx = len + idx;
+        if (idx < 0 || idx >= len) throw std::runtime_error("Индекс вне границ списка");
+        // упакованный список остается упакованным, пока в него пишутся числа
+        if (items.packed() && std::holds_alternative<double>(value)) {
+            double& number = items.mutable_numbers()[idx];
+            Value result = compound ? apply_binary_op(assign->specialization, Value(number), std::move(value), op) : std::move(value);
+            if (std::holds_alternative<double>(result)) {
+                number = std::get<double>(result);
+                return result;
             }
-            if (name == "round" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент round() должен быть числом");
-                return std::round(std::get<double>(v));
+            items.elements()[idx] = result;
+            return result;
+        }
+        return update(items.elements()[idx]);
+    }
+    auto& data = std::get<Array>(container)->data;
+    int64_t len = static_cast<int64_t>(data.size());
+    if (idx < 0) idx = len + idx;
+    if (idx < 0 || idx >= len) throw std::runtime_error("Индекс вне границ массива");
+    Value result = compound ? apply_binary_op(assign->specialization, Value(data[idx]), std::move(value), op) : std::move(value);
+    if (!std::holds_alternative<double>(result)) throw std::runtime_error("Элементы массива должны быть числами");
+    data[idx] = std::get<double>(result);
+    return result;
+}
+
+// имя связано с пользовательским значением (и перекрывает встроенную функцию)
+static bool is_bound(const VariableNode* var, Environment& env) {
+    if (var->slot < 0) return env.has(var->name);
+    return !is_unbound(env.slot(var->slot));
+}
+
+// запись отсортированных элементов обратно в список; упакованный список остается упакованным
+static void store_sorted(const List& lst, std::vector<Value> items) {
+    if (lst->size() != items.size()) throw std::runtime_error("Список изменился во время сортировки");
+    if (lst->packed()) {
+        auto& numbers = lst->mutable_numbers();
+        for (size_t i = 0; i < items.size(); ++i) numbers[i] = std::get<double>(items[i]);
+    } else {
+        std::move(items.begin(), items.end(), lst->elements().begin());
+    }
+}
+
+// сортировка без функции: числа и строки сортируются распакованными, смешанный список не меняется
+static void sort_list(const List& lst) {
+    if (lst->packed()) {
+        auto& numbers = lst->mutable_numbers();
+        sort_numbers(numbers.data(), numbers.size());
+        return;
+    }
+    auto& elements = lst->elements();
+    if (std::all_of(elements.begin(), elements.end(), [](const Value& e) { return std::holds_alternative<double>(e); })) {
+        std::vector<double> numbers;
+        numbers.reserve(elements.size());
+        for (const auto& e : elements) numbers.push_back(std::get<double>(e));
+        sort_numbers(numbers.data(), numbers.size());
+        for (size_t i = 0; i < numbers.size(); ++i) elements[i] = numbers[i];
+    } else if (std::all_of(elements.begin(), elements.end(), [](const Value& e) { return std::holds_alternative<Str>(e); })) {
+        std::vector<Str> strings;
+        strings.reserve(elements.size());
+        for (const auto& e : elements) strings.push_back(std::get<Str>(e));
+        std::sort(strings.begin(), strings.end());
+        for (size_t i = 0; i < strings.size(); ++i) elements[i] = std::move(strings[i]);
+    }
+}
+
+// decorate-sort-undecorate: ключ вычисляется один раз на элемент, пары (ключ, позиция)
+// сортируются, а позиция делает порядок равных ключей устойчивым
+static void sort_by_key(const List& lst, const Function& key, Environment& env) {
+    std::vector<Value> items;
+    items.reserve(lst->size());
+    for (size_t i = 0; i < lst->size(); ++i) items.push_back(lst->get(i));
+    std::vector<Value> keys;
+    keys.reserve(items.size());
+    for (const auto& item : items) keys.push_back(call_function(key, {item}, env));
+
+    std::vector<size_t> order;
+    if (std::all_of(keys.begin(), keys.end(), [](const Value& k) { return std::holds_alternative<double>(k); })) {
+        std::vector<std::pair<double, size_t>> decorated;
+        decorated.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) decorated.emplace_back(std::get<double>(keys[i]), i);
+        std::sort(decorated.begin(), decorated.end());
+        for (const auto& entry : decorated) order.push_back(entry.second);
+    } else if (std::all_of(keys.begin(), keys.end(), [](const Value& k) { return std::holds_alternative<Str>(k); })) {
+        std::vector<std::pair<Str, size_t>> decorated;
+        decorated.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) decorated.emplace_back(std::get<Str>(keys[i]), i);
+        std::sort(decorated.begin(), decorated.end());
+        for (const auto& entry : decorated) order.push_back(entry.second);
+    } else {
+        throw std::runtime_error("Ключи sort() должны быть либо все числами, либо все строками");
+    }
+
+    std::vector<Value> sorted;
+    sorted.reserve(items.size());
+    for (size_t i : order) sorted.push_back(std::move(items[i]));
+    store_sorted(lst, std::move(sorted));
+}
+
+// сортировка с функцией сравнения cmp(a, b), истинной, если a должен стоять раньше b
+static void sort_with_comparator(const List& lst, const Function& cmp, Environment& env) {
+    std::vector<Value> items;
+    items.reserve(lst->size());
+    for (size_t i = 0; i < lst->size(); ++i) items.push_back(lst->get(i));
+    std::stable_sort(items.begin(), items.end(), [&](const Value& a, const Value& b) {
+        return isTruthy(call_function(cmp, {a, b}, env));
+    });
+    store_sorted(lst, std::move(items));
+}
+
+// вызов встроенной функции; nullopt - встроенной функции с таким именем и числом аргументов нет.
+// вынесен из evaluate, чтобы локальные переменные встроенных функций не увеличивали кадр
+// evaluate на каждом уровне рекурсии пользовательских функций
+static std::optional<Value> call_builtin(const std::string& name, const CallNode* call, Environment& env) {
+    // функция len
+    if (name == "len" && call->arguments.size() == 1) {
+        auto val = evaluate(call->arguments[0].get(), env);
+        if (std::holds_alternative<Str>(val)) {
+            return static_cast<double>(std::get<Str>(val).size());
+        } else if (std::holds_alternative<List>(val)) {
+            return static_cast<double>(std::get<List>(val)->size());
+        } else if (std::holds_alternative<Map>(val)) {
+            return static_cast<double>(std::get<Map>(val)->table.size());
+        } else if (std::holds_alternative<Set>(val)) {
+            return static_cast<double>(std::get<Set>(val)->table.size());
+        } else if (std::holds_alternative<Builder>(val)) {
+            return static_cast<double>(std::get<Builder>(val)->buffer.size());
+        } else if (std::holds_alternative<Array>(val)) {
+            return static_cast<double>(std::get<Array>(val)->data.size());
+        }
+        throw std::runtime_error("Аргумент len() должен быть строкой, списком, массивом, словарем или множеством");
+    }
+    // функция range
+    if (name == "range") {
+        size_t argc = call->arguments.size();
+        if (argc == 1) {
+            auto endVal = evaluate(call->arguments[0].get(), env);
+            if (!std::holds_alternative<double>(endVal)) throw std::runtime_error("Аргумент range() должен быть числом");
+            double end = std::get<double>(endVal);
+            PooledVector<double> numbers;
+            if (end > 0) numbers.reserve(static_cast<size_t>(std::ceil(end)));
+            for (double v = 0; v < end; v += 1) numbers.push_back(v);
+            return make_ref<ListValue>(std::move(numbers));
+        } else if (argc == 2) {
+            auto startVal = evaluate(call->arguments[0].get(), env);
+            auto endVal = evaluate(call->arguments[1].get(), env);
+            if (!std::holds_alternative<double>(startVal) || !std::holds_alternative<double>(endVal)) throw std::runtime_error("Аргументы range() должны быть числами");
+            double start = std::get<double>(startVal);
+            double end = std::get<double>(endVal);
+            PooledVector<double> numbers;
+            if (end > start) numbers.reserve(static_cast<size_t>(std::ceil(end - start)));
+            for (double v = start; v < end; v += 1) numbers.push_back(v);
+            return make_ref<ListValue>(std::move(numbers));
+        } else if (argc == 3) {
+            auto startVal = evaluate(call->arguments[0].get(), env);
+            auto endVal = evaluate(call->arguments[1].get(), env);
+            auto stepVal = evaluate(call->arguments[2].get(), env);
+            if (!std::holds_alternative<double>(startVal) || !std::holds_alternative<double>(endVal) || !std::holds_alternative<double>(stepVal)) throw std::runtime_error("Аргументы range() должны быть числами");
+            double start = std::get<double>(startVal);
+            double end = std::get<double>(endVal);
+            double step = std::get<double>(stepVal);
+            if (step == 0) throw std::runtime_error("Шаг range() не может быть нулевым");
+            PooledVector<double> numbers;
+            if ((end - start) / step > 0) numbers.reserve(static_cast<size_t>(std::ceil((end - start) / step)));
+            if (step > 0) {
+                for (double v = start; v < end; v += step) numbers.push_back(v);
+            } else {
+                for (double v = start; v > end; v += step) numbers.push_back(v);
             }
-            if (name == "sqrt" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент sqrt() должен быть числом");
-                return std::sqrt(std::get<double>(v));
+            return make_ref<ListValue>(std::move(numbers));
+        }
+        throw std::runtime_error("range() ожидает 1, 2 или 3 аргумента");
+    }
+    if (name == "read" && call->arguments.empty()) {
+        Str line;
+        g_input_reader->next(line);
+        return line;
+    }
+    if (name == "eof" && call->arguments.empty()) {
+        return static_cast<double>(g_input_reader->eof());
+    }
+    if (name == "lines" && call->arguments.empty()) {
+        return Iterator(std::make_shared<LinesIterator>(g_input_reader));
+    }
+    // работа с файлами
+    if ((name == "read_file" || name == "file_lines") && call->arguments.size() == 1) {
+        auto pathVal = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Str>(pathVal)) throw std::runtime_error("Аргумент " + name + "() должен быть строкой");
+        std::string path = std::get<Str>(pathVal).str();
+        if (name == "read_file") return read_file(path);
+        return file_lines(path);
+    }
+    if ((name == "write_file" || name == "append_file") && call->arguments.size() == 2) {
+        auto pathVal = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Str>(pathVal)) throw std::runtime_error("Первый аргумент " + name + "() должен быть строкой");
+        auto data = evaluate(call->arguments[1].get(), env);
+        if (std::holds_alternative<Str>(data)) {
+            write_file(std::get<Str>(pathVal).str(), std::get<Str>(data).view(), name == "append_file");
+        } else {
+            std::ostringstream text;
+            write_value(text, data);
+            write_file(std::get<Str>(pathVal).str(), text.str(), name == "append_file");
+        }
+        return NullType{};
+    }
+    // freeze: список (вместе с вложенными) или функция становится неизменяемой и может разделяться между потоками
+    if (name == "freeze" && call->arguments.size() == 1) {
+        auto val = evaluate(call->arguments[0].get(), env);
+        if (auto list = std::get_if<List>(&val)) {
+            (*list)->freeze();
+        } else if (auto function = std::get_if<Function>(&val)) {
+            (*function)->freeze();
+        } else {
+            throw std::runtime_error("freeze применима только к спискам и функциям");
+        }
+        return val;
+    }
+    // сборка циклов ссылок между списками и словарями
+    if (name == "gc" && call->arguments.empty()) {
+        return static_cast<double>(collect_cycles());
+    }
+    if (name == "gc_stats" && call->arguments.empty()) {
+        const GcStats& stats = gc_stats();
+        auto result = make_ref<MapValue>();
+        *result->table.try_emplace(Str("collections")).first = static_cast<double>(stats.collections);
+        *result->table.try_emplace(Str("collected")).first = static_cast<double>(stats.collected);
+        *result->table.try_emplace(Str("tracked")).first = static_cast<double>(stats.tracked);
+        *result->table.try_emplace(Str("last_pause_ms")).first = stats.last_pause_ms;
+        *result->table.try_emplace(Str("max_pause_ms")).first = stats.max_pause_ms;
+        *result->table.try_emplace(Str("total_pause_ms")).first = stats.total_pause_ms;
+        return result;
+    }
+    if (name == "stacktrace" && call->arguments.empty()) {
+        // вызовы пользовательских функций от внешнего к текущему
+        auto result = make_ref<ListValue>();
+        for (const auto& record : g_call_stack.records()) result->push(Str(describe_call(record)));
+        return result;
+    }
+    // математические функции
+    if (name == "abs" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент abs() должен быть числом");
+        return std::fabs(std::get<double>(v));
+    }
+    if (name == "ceil" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент ceil() должен быть числом");
+        return std::ceil(std::get<double>(v));
+    }
+    if (name == "floor" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент floor() должен быть числом");
+        return std::floor(std::get<double>(v));
+    }
+    if (name == "round" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент round() должен быть числом");
+        return std::round(std::get<double>(v));
+    }
+    if (name == "sqrt" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент sqrt() должен быть числом");
+        return std::sqrt(std::get<double>(v));
+    }
+    if (name == "rnd" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент rnd() должен быть числом");
+        int64_t n = to_index(std::get<double>(v));
+        if (n <= 0) return 0.0;
+        if (n > RAND_MAX) n = static_cast<int64_t>(RAND_MAX) + 1;
+        return static_cast<double>(std::rand() % n);
+    }
+    // работа со строками
+    if (name == "parse_num" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Str>(v)) return NullType{};
+        const Str& s = std::get<Str>(v);
+        try {
+            double x = std::stod(s.str());
+            return x;
+        } catch (...) {
+            return NullType{};
+        }
+    }
+    if (name == "to_string" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент to_string() должен быть числом");
+        return format_number(std::get<double>(v));
+    }
+    if (name == "lower" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Str>(v)) throw std::runtime_error("Аргумент lower() должен быть строкой");
+        return ascii_lower(std::get<Str>(v).view());
+    }
+    if (name == "upper" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Str>(v)) throw std::runtime_error("Аргумент upper() должен быть строкой");
+        return ascii_upper(std::get<Str>(v).view());
+    }
+    if (name == "split" && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto d = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<Str>(v) || !std::holds_alternative<Str>(d)) throw std::runtime_error("Аргументы split() должны быть строками");
+        const Str &str = std::get<Str>(v);
+        std::string_view delim = std::get<Str>(d).view();
+        auto result = make_ref<ListValue>();
+        if (delim.empty()) { // пустой разделитель делит строку на символы
+            result->reserve(str.size());
+            for (size_t i = 0; i < str.size(); ++i) result->push(str.substr(i, 1));
+            return result;
+        }
+        std::vector<size_t> positions;
+        find_all(str.view(), delim, positions);
+        result->reserve(positions.size() + 1);
+        size_t start = 0;
+        for (size_t pos : positions) {
+            result->push(str.substr(start, pos - start));
+            start = pos + delim.length();
+        }
+        result->push(str.substr(start));
+        return result;
+    }
+    if (name == "join" && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto d = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<List>(v) || !std::holds_alternative<Str>(d)) throw std::runtime_error("Аргументы join() должны быть списком и строкой");
+        const List &lst = std::get<List>(v);
+        std::string_view delim = std::get<Str>(d).view();
+        size_t total = 0;
+        for (size_t i = 0; i < lst->size(); ++i) {
+            Value elem = lst->get(i);
+            if (std::holds_alternative<Str>(elem)) total += std::get<Str>(elem).size() + delim.size();
+        }
+        std::string out;
+        out.reserve(total);
+        for (size_t i = 0; i < lst->size(); ++i) {
+            Value elem = lst->get(i);
+            if (!std::holds_alternative<Str>(elem)) throw std::runtime_error("Элементы списка join() должны быть строками");
+            if (i > 0) out += delim;
+            out += std::get<Str>(elem).view();
+        }
+        return out;
+    }
+    if (name == "replace" && call->arguments.size() == 3) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto oldv = evaluate(call->arguments[1].get(), env);
+        auto newv = evaluate(call->arguments[2].get(), env);
+        if (!std::holds_alternative<Str>(v) || !std::holds_alternative<Str>(oldv) || !std::holds_alternative<Str>(newv)) throw std::runtime_error("Аргументы replace() должны быть строками");
+        return replace_all(std::get<Str>(v).view(), std::get<Str>(oldv).view(), std::get<Str>(newv).view());
+    }
+    if ((name == "find" || name == "contains" || name == "starts_with" || name == "count") && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto sub = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<Str>(v) || !std::holds_alternative<Str>(sub)) throw std::runtime_error("Аргументы " + name + "() должны быть строками");
+        std::string_view str = std::get<Str>(v).view();
+        std::string_view needle = std::get<Str>(sub).view();
+        if (name == "find") {
+            size_t pos = find_substring(str, needle);
+            return pos == std::string_view::npos ? -1.0 : static_cast<double>(pos);
+        }
+        if (name == "contains") return static_cast<double>(find_substring(str, needle) != std::string_view::npos);
+        if (name == "starts_with") return static_cast<double>(str.starts_with(needle));
+        return static_cast<double>(count_substring(str, needle));
+    }
+    // построитель строк
+    if (name == "builder" && call->arguments.size() <= 1) {
+        auto result = std::make_shared<BuilderValue>();
+        if (call->arguments.empty()) return result;
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Str>(v)) throw std::runtime_error("Аргумент builder() должен быть строкой");
+        result->buffer = std::get<Str>(v).str();
+        return result;
+    }
+    if (name == "append" && call->arguments.size() == 2) {
+        auto b = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Builder>(b)) throw std::runtime_error("Первый аргумент append() должен быть построителем строк");
+        std::string& buffer = std::get<Builder>(b)->buffer;
+        auto v = evaluate(call->arguments[1].get(), env);
+        if (std::holds_alternative<Str>(v)) {
+            buffer += std::get<Str>(v).view();
+        } else if (std::holds_alternative<double>(v)) {
+            buffer += format_number(std::get<double>(v));
+        } else if (std::holds_alternative<Builder>(v)) {
+            buffer += std::get<Builder>(v)->buffer;
+        } else {
+            throw std::runtime_error("Второй аргумент append() должен быть строкой или числом");
+        }
+        return NullType{};
+    }
+    if (name == "build" && call->arguments.size() == 1) {
+        auto b = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Builder>(b)) throw std::runtime_error("Аргумент build() должен быть построителем строк");
+        return std::get<Builder>(b)->buffer;
+    }
+    // работа со списками
+    if (name == "push" && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<List>(v)) throw std::runtime_error("Первый аргумент push() должен быть списком");
+        List lst = std::get<List>(v);
+        auto elem = evaluate(call->arguments[1].get(), env);
+        lst->push(elem);
+        return NullType{};
+    }
+    if (name == "pop" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<List>(v)) throw std::runtime_error("Аргумент pop() должен быть списком");
+        List lst = std::get<List>(v);
+        if (lst->empty()) return NullType{};
+        Value last = lst->get(lst->size() - 1);
+        lst->pop();
+        return last;
+    }
+    if (name == "insert" && call->arguments.size() == 3) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto idxv = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<List>(v) || !std::holds_alternative<double>(idxv)) throw std::runtime_error("Аргументы insert() должны быть списком и индексом");
+        List lst = std::get<List>(v);
+        int64_t idx = to_index(std::get<double>(idxv));
+        if (idx < 0) idx = 0;
+        if (idx > static_cast<int64_t>(lst->size())) idx = lst->size();
+        Value elem = evaluate(call->arguments[2].get(), env);
+        lst->insert(idx, elem);
+        return NullType{};
+    }
+    if (name == "remove" && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto idxv = evaluate(call->arguments[1].get(), env);
+        if (std::holds_alternative<Set>(v)) {
+            if (!is_hashable(idxv)) return 0.0;
+            return static_cast<double>(std::get<Set>(v)->table.erase(idxv));
+        }
+        if (!std::holds_alternative<List>(v) || !std::holds_alternative<double>(idxv)) throw std::runtime_error("Аргументы remove() должны быть списком и индексом");
+        List lst = std::get<List>(v);
+        int64_t idx = to_index(std::get<double>(idxv));
+        if (idx < 0 || idx >= static_cast<int64_t>(lst->size())) return NullType{};
+        Value val = lst->get(idx);
+        lst->erase(idx);
+        return val;
+    }
+    if (name == "sort" && (call->arguments.size() == 1 || call->arguments.size() == 2)) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<List>(v)) throw std::runtime_error("Аргумент sort() должен быть списком");
+        List lst = std::get<List>(v);
+        if (call->arguments.size() == 1) {
+            sort_list(lst);
+            return NullType{};
+        }
+        auto fv = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<Function>(fv)) throw std::runtime_error("Второй аргумент sort() должен быть функцией");
+        const Function& f = std::get<Function>(fv);
+        if (f->parameters.size() == 1) {
+            sort_by_key(lst, f, env);
+        } else if (f->parameters.size() == 2) {
+            sort_with_comparator(lst, f, env);
+        } else {
+            throw std::runtime_error("Функция sort() должна принимать один аргумент (ключ) или два (сравнение)");
+        }
+        return NullType{};
+    }
+    // свертки числовых списков и массивов
+    if ((name == "sum" || name == "min" || name == "max" || name == "mean" || name == "argmin" || name == "argmax") && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        std::vector<double> buffer;
+        size_t n = 0;
+        const double* data = numbers_of(v, n, buffer, name);
+        if (name == "sum") return sum_numbers(data, n);
+        if (n == 0) return NullType{};
+        if (name == "min") return min_number(data, n);
+        if (name == "max") return max_number(data, n);
+        if (name == "mean") return sum_numbers(data, n) / static_cast<double>(n);
+        if (name == "argmin") return static_cast<double>(argmin_number(data, n));
+        return static_cast<double>(argmax_number(data, n));
+    }
+    if (name == "dot" && call->arguments.size() == 2) {
+        auto a = evaluate(call->arguments[0].get(), env);
+        auto b = evaluate(call->arguments[1].get(), env);
+        std::vector<double> left_buffer, right_buffer;
+        size_t left_size = 0, right_size = 0;
+        const double* left = numbers_of(a, left_size, left_buffer, name);
+        const double* right = numbers_of(b, right_size, right_buffer, name);
+        if (left_size != right_size) throw std::runtime_error("Аргументы dot() должны быть одинаковой длины");
+        return dot_numbers(left, right, left_size);
+    }
+    if ((name == "count_if_gt" || name == "count_if_lt") && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto threshold = evaluate(call->arguments[1].get(), env);
+        std::vector<double> buffer;
+        size_t n = 0;
+        const double* data = numbers_of(v, n, buffer, name);
+        if (!std::holds_alternative<double>(threshold)) throw std::runtime_error("Второй аргумент " + name + "() должен быть числом");
+        double limit = std::get<double>(threshold);
+        size_t count = name == "count_if_gt" ? count_greater(data, n, limit) : count_less(data, n, limit);
+        return static_cast<double>(count);
+    }
+    // работа с массивами
+    if (name == "array" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        std::vector<double> buffer;
+        size_t n = 0;
+        const double* data = numbers_of(v, n, buffer, name);
+        auto result = std::make_shared<ArrayValue>();
+        result->data.assign(data, data + n);
+        return result;
+    }
+    if (name == "zeros" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент zeros() должен быть числом");
+        double n = std::get<double>(v);
+        auto result = std::make_shared<ArrayValue>();
+        if (n > 0) result->data.resize(static_cast<size_t>(n));
+        return result;
+    }
+    if (name == "linspace" && call->arguments.size() == 3) {
+        auto startVal = evaluate(call->arguments[0].get(), env);
+        auto stopVal = evaluate(call->arguments[1].get(), env);
+        auto countVal = evaluate(call->arguments[2].get(), env);
+        if (!std::holds_alternative<double>(startVal) || !std::holds_alternative<double>(stopVal) || !std::holds_alternative<double>(countVal)) {
+            throw std::runtime_error("Аргументы linspace() должны быть числами");
+        }
+        double start = std::get<double>(startVal);
+        double stop = std::get<double>(stopVal);
+        double count = std::get<double>(countVal);
+        auto result = std::make_shared<ArrayValue>();
+        if (count <= 0) return result;
+        size_t n = static_cast<size_t>(count);
+        result->data.resize(n);
+        // n точек от start до stop включительно
+        double step = n > 1 ? (stop - start) / static_cast<double>(n - 1) : 0.0;
+        for (size_t i = 0; i < n; ++i) result->data[i] = start + step * static_cast<double>(i);
+        if (n > 1) result->data[n - 1] = stop;
+        return result;
+    }
+    if (name == "to_list" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (std::holds_alternative<Array>(v)) return make_ref<ListValue>(std::get<Array>(v)->data);
+        if (!std::holds_alternative<Iterator>(v)) throw std::runtime_error("Аргумент to_list() должен быть массивом или итератором");
+        auto result = make_ref<ListValue>();
+        Value item;
+        while (std::get<Iterator>(v)->next(item)) result->push(std::move(item));
+        return result;
+    }
+    // работа со словарями
+    if (name == "keys" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Map>(v)) throw std::runtime_error("Аргумент keys() должен быть словарем");
+        const Map& map = std::get<Map>(v);
+        auto result = make_ref<ListValue>();
+        result->reserve(map->table.size());
+        map->table.for_each([&](const Value& key, const Value&) { result->push(key); });
+        return result;
+    }
+    if (name == "values" && call->arguments.size() == 1) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<Map>(v)) throw std::runtime_error("Аргумент values() должен быть словарем");
+        const Map& map = std::get<Map>(v);
+        auto result = make_ref<ListValue>();
+        result->reserve(map->table.size());
+        map->table.for_each([&](const Value&, const Value& value) { result->push(value); });
+        return result;
+    }
+    if (name == "has" && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto key = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<Map>(v) && !std::holds_alternative<Set>(v)) throw std::runtime_error("Первый аргумент has() должен быть словарем или множеством");
+        return static_cast<double>(contains_value(v, key));
+    }
+    if (name == "put" && call->arguments.size() == 3) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto key = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<Map>(v)) throw std::runtime_error("Первый аргумент put() должен быть словарем");
+        if (!is_hashable(key)) throw std::runtime_error("Ключ словаря должен быть числом или строкой");
+        Value value = evaluate(call->arguments[2].get(), env);
+        *std::get<Map>(v)->table.try_emplace(key).first = std::move(value);
+        return NullType{};
+    }
+    if (name == "del" && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto key = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<Map>(v)) throw std::runtime_error("Первый аргумент del() должен быть словарем");
+        if (!is_hashable(key)) return NullType{};
+        Map map = std::get<Map>(v);
+        Value* found = map->table.find(key);
+        if (!found) return NullType{};
+        Value removed = std::move(*found);
+        map->table.erase(key);
+        return removed;
+    }
+    // работа с множествами
+    if (name == "set" && call->arguments.size() <= 1) {
+        auto result = std::make_shared<SetValue>();
+        if (call->arguments.empty()) return result;
+        auto v = evaluate(call->arguments[0].get(), env);
+        if (!std::holds_alternative<List>(v)) throw std::runtime_error("Аргумент set() должен быть списком");
+        const List& lst = std::get<List>(v);
+        result->table.reserve(lst->size());
+        for (size_t i = 0; i < lst->size(); ++i) {
+            Value elem = lst->get(i);
+            if (!is_hashable(elem)) throw std::runtime_error("Элемент множества должен быть числом или строкой");
+            result->table.try_emplace(elem);
+        }
+        return result;
+    }
+    if (name == "add" && call->arguments.size() == 2) {
+        auto v = evaluate(call->arguments[0].get(), env);
+        auto elem = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<Set>(v)) throw std::runtime_error("Первый аргумент add() должен быть множеством");
+        if (!is_hashable(elem)) throw std::runtime_error("Элемент множества должен быть числом или строкой");
+        std::get<Set>(v)->table.try_emplace(elem);
+        return NullType{};
+    }
+    if ((name == "union" || name == "intersect" || name == "difference") && call->arguments.size() == 2) {
+        auto a = evaluate(call->arguments[0].get(), env);
+        auto b = evaluate(call->arguments[1].get(), env);
+        if (!std::holds_alternative<Set>(a) || !std::holds_alternative<Set>(b)) throw std::runtime_error("Аргументы " + name + "() должны быть множествами");
+        const auto& left = std::get<Set>(a)->table;
+        const auto& right = std::get<Set>(b)->table;
+        auto result = std::make_shared<SetValue>();
+        if (name == "union") {
+            result->table = left;
+            result->table.reserve(left.size() + right.size());
+            right.for_each([&](const Value& elem, const NoValue&) { result->table.try_emplace(elem); });
+        } else if (name == "intersect") {
+            // обходим меньшее множество, проверяя элементы в большем
+            const auto& small = left.size() <= right.size() ? left : right;
+            const auto& large = left.size() <= right.size() ? right : left;
+            small.for_each([&](const Value& elem, const NoValue&) {
+                if (large.contains(elem)) result->table.try_emplace(elem);
+            });
+        } else {
+            left.for_each([&](const Value& elem, const NoValue&) {
+                if (!right.contains(elem)) result->table.try_emplace(elem);
+            });
+        }
+        return result;
+    }
+    return std::nullopt;
+}
+
+Value evaluate(const ASTNode* node, Environment& env) { // вычисляет значение узла AST и возвращает результат типа Value
+    switch (node->kind) {
+        // обработка функции
+        case NodeKind::Function: {
+            auto fnNode = static_cast<const FunctionNode*>(node);
+            auto fval = make_ref<FunctionValue>();
+            fval->parameters = fnNode->parameters;
+            fval->frame_size = fnNode->frame_size;
+            fval->node = fnNode;
+            for (const auto& stmt : fnNode->body) {
+                fval->body.push_back(stmt.get());
             }
-            if (name == "rnd" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент rnd() должен быть числом");
-                int n = static_cast<int>(std::get<double>(v));
-                if (n <= 0) return 0.0;
-                return static_cast<double>(std::rand() % n);
+            return fval;
+        }
+        // возврат null
+        case NodeKind::Null: {
+            return NullType{};
+        }
+        // возврат числа
+        case NodeKind::Number: {
+            auto num = static_cast<const NumberNode*>(node);
+            return num->value;
+        }
+        // возврат строки
+        case NodeKind::String: {
+            auto str = static_cast<const StringNode*>(node);
+            return str->value;
+        }
+        // обработка вызова функции
+        case NodeKind::Call: {
+            auto call = static_cast<const CallNode*>(node);
+            // переменная пользователя перекрывает встроенную функцию с тем же именем
+            if (auto fn = as_variable(call->callee.get()); fn && !is_bound(fn, env)) {
+                if (auto result = call_builtin(fn->name, call, env)) return std::move(*result);
             }
-            // работа со строками
-            if (name == "parse_num" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<std::string>(v)) return NullType{};
-                const std::string& s = std::get<std::string>(v);
-                try {
-                    double x = std::stod(s);
-                    return x;
-                } catch (...) {
-                    return NullType{};
+            // вызов функции через значение
+            {
+                Value calleeVal = evaluate(call->callee.get(), env);
+                if (std::holds_alternative<Function>(calleeVal)) {
+                    auto f = std::get<Function>(calleeVal);
+                    if (call->arguments.size() != f->parameters.size()) {
+                        throw std::runtime_error("Несоответствие количества аргументов");
+                    }
+                    // аргументы вычисляются прямо в ячейки параметров кадра вызываемой функции
+                    CallFrame frame(frame_size(*f));
+                    for (size_t i = 0; i < call->arguments.size(); ++i) {
+                        frame.slots()[i] = evaluate(call->arguments[i].get(), env);
+                    }
+                    return invoke(f, frame, env, call->line);
                 }
             }
-            if (name == "to_string" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<double>(v)) throw std::runtime_error("Аргумент to_string() должен быть числом");
-                return format_number(std::get<double>(v));
-            }
-            if (name == "lower" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<std::string>(v)) throw std::runtime_error("Аргумент lower() должен быть строкой");
-                std::string s = std::get<std::string>(v);
-                for (char &c : s) c = std::tolower(c);
-                return s;
-            }
-            if (name == "upper" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<std::string>(v)) throw std::runtime_error("Аргумент upper() должен быть строкой");
-                std::string s = std::get<std::string>(v);
-                for (char &c : s) c = std::toupper(c);
-                return s;
-            }
-            if (name == "split" && call->arguments.size() == 2) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                auto d = evaluate(call->arguments[1].get(), env);
-                if (!std::holds_alternative<std::string>(v) || !std::holds_alternative<std::string>(d)) throw std::runtime_error("Аргументы split() должны быть строками");
-                const std::string &str = std::get<std::string>(v);
-                const std::string &delim = std::get<std::string>(d);
-                auto result = std::make_shared<ListValue>();
-                size_t start = 0, pos;
-                while ((pos = str.find(delim, start)) != std::string::npos) {
-                    result->elements.push_back(str.substr(start, pos - start));
-                    start = pos + delim.length();
-                }
-                result->elements.push_back(str.substr(start));
-                return result;
+            throw std::runtime_error("Неизвестный вызов функции");
+        }
+        // создание списка
+        case NodeKind::List: {
+            auto listNode = static_cast<const ListNode*>(node);
+            auto result = make_ref<ListValue>();
+            result->reserve(listNode->elements.size());
+            for (const auto& elem : listNode->elements) {
+                auto value = evaluate(elem.get(), env);
+                result->push(value);
             }
-            if (name == "join" && call->arguments.size() == 2) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                auto d = evaluate(call->arguments[1].get(), env);
-                if (!std::holds_alternative<List>(v) || !std::holds_alternative<std::string>(d)) throw std::runtime_error("Аргументы join() должны быть списком и строкой");
-                const List &lst = std::get<List>(v);
-                const std::string &delim = std::get<std::string>(d);
-                std::string out;
-                for (size_t i = 0; i < lst->elements.size(); ++i) {
-                    const auto &elem = lst->elements[i];
-                    if (!std::holds_alternative<std::string>(elem)) throw std::runtime_error("Элементы списка join() должны быть строками");
-                    if (i > 0) out += delim;
-                    out += std::get<std::string>(elem);
-                }
-                return out;
+            return result;
+        }
+        // создание словаря
+        case NodeKind::Map: {
+            auto mapNode = static_cast<const MapNode*>(node);
+            auto result = make_ref<MapValue>();
+            result->table.reserve(mapNode->entries.size());
+            for (const auto& entry : mapNode->entries) {
+                auto key = evaluate(entry.first.get(), env);
+                if (!is_hashable(key)) throw std::runtime_error("Ключ словаря должен быть числом или строкой");
+                auto value = evaluate(entry.second.get(), env);
+                *result->table.try_emplace(key).first = std::move(value);
             }
-            if (name == "replace" && call->arguments.size() == 3) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                auto oldv = evaluate(call->arguments[1].get(), env);
-                auto newv = evaluate(call->arguments[2].get(), env);
-                if (!std::holds_alternative<std::string>(v) || !std::holds_alternative<std::string>(oldv) || !std::holds_alternative<std::string>(newv)) throw std::runtime_error("Аргументы replace() должны быть строками");
-                std::string s = std::get<std::string>(v);
-                const std::string &oldstr = std::get<std::string>(oldv);
-                const std::string &newstr = std::get<std::string>(newv);
-                size_t pos = 0;
-                while ((pos = s.find(oldstr, pos)) != std::string::npos) {
-                    s.replace(pos, oldstr.length(), newstr);
-                    pos += newstr.length();
+            return result;
+        }
+        // получение переменной
+        case NodeKind::Variable: {
+            auto var = static_cast<const VariableNode*>(node);
+            return read_variable(var, env);
+        }
+        // бинарная операция
+        case NodeKind::Binary: {
+            auto binary = static_cast<const BinaryOpNode*>(node);
+            auto left = evaluate(binary->left.get(), env);
+            auto right = evaluate(binary->right.get(), env);
+            return apply_binary_op(binary->specialization, std::move(left), std::move(right), binary->op);
+        }
+        // вынесенное из цикла выражение
+        case NodeKind::Invariant: {
+            auto invariant = static_cast<const InvariantNode*>(node);
+            InvariantCache& cache = *invariant->cache;
+            if (cache.state == InvariantCache::State::Cached) return cache.value;
+            Value value = evaluate(invariant->expr.get(), env);
+            if (cache.state == InvariantCache::State::Empty) {
+                auto immutable = [](const Value& v) {
+                    return std::holds_alternative<double>(v) || std::holds_alternative<Str>(v) ||
+                           std::holds_alternative<NullType>(v);
+                };
+                // изменяемый результат нельзя разделять между итерациями
+                bool cacheable = immutable(value);
+                if (cacheable && invariant->immutable_inputs_only) {
+                    for (const auto& input : invariant->inputs) {
+                        if (!immutable(read_variable(input, env))) {
+                            cacheable = false;
+                            break;
+                        }
+                    }
                 }
-                return s;
+                if (cacheable) cache.value = value;
+                cache.state = cacheable ? InvariantCache::State::Cached : InvariantCache::State::Uncacheable;
             }
-            // работа со списками
-            if (name == "push" && call->arguments.size() == 2) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<List>(v)) throw std::runtime_error("Первый аргумент push() должен быть списком");
-                List lst = std::get<List>(v);
-                auto elem = evaluate(call->arguments[1].get(), env);
-                lst->elements.push_back(elem);
-                return NullType{};
-            }
-            if (name == "pop" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<List>(v)) throw std::runtime_error("Аргумент pop() должен быть списком");
-                List lst = std::get<List>(v);
-                if (lst->elements.empty()) return NullType{};
-                Value last = lst->elements.back();
-                lst->elements.pop_back();
-                return last;
+            return value;
+        }
+        // x op c с нейтральным для чисел c: число возвращается без вычисления операции
+        case NodeKind::NumericIdentity: {
+            auto identity = static_cast<const NumericIdentityNode*>(node);
+            const BinaryOpNode* binary = identity->op.get();
+            const ASTNode* operand_node = identity->operand_left ? binary->left.get() : binary->right.get();
+            const ASTNode* constant_node = identity->operand_left ? binary->right.get() : binary->left.get();
+            auto operand = evaluate(operand_node, env);
+            if (std::holds_alternative<double>(operand)) return operand;
+            auto constant = evaluate(constant_node, env);
+            if (identity->operand_left) return apply_binary_op(std::move(operand), std::move(constant), binary->op);
+            return apply_binary_op(std::move(constant), std::move(operand), binary->op);
+        }
+        // унарная операция
+        case NodeKind::Unary: {
+            auto unary = static_cast<const UnaryOpNode*>(node);
+            auto operand = evaluate(unary->operand.get(), env);
+            return apply_unary_op(unary->op, operand);
+        }
+        // присваивание
+        case NodeKind::Assign: {
+            auto assign = static_cast<const AssignNode*>(node);
+            auto value = evaluate(assign->value.get(), env);
+            if (assign->op == TokenType::EQUALS) {
+                write_variable(assign->slot, assign->var_name, value, env);
+            } else {
+                // переменная меняется через ссылку: без копии текущего значения, а строки
+                // и списки дописываются на место
+                Value& target = assign->slot < 0 ? env.variable(assign->var_name) : env.slot(assign->slot);
+                if (is_unbound(target)) throw std::runtime_error("Неопределенная переменная: " + assign->var_name);
+                TokenType op = get_binary_op_from_compound_assign(assign->op);
+                if (!std::holds_alternative<double>(target) && compound_assign_in_place(target, value, op)) return target;
+                // при ошибке операции переменная остается прежней: операнды передаются по ссылке
+                target = apply_binary_op(assign->specialization, std::move(target), std::move(value), op);
+                return target;
             }
-            if (name == "insert" && call->arguments.size() == 3) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                auto idxv = evaluate(call->arguments[1].get(), env);
-                if (!std::holds_alternative<List>(v) || !std::holds_alternative<double>(idxv)) throw std::runtime_error("Аргументы insert() должны быть списком и индексом");
-                List lst = std::get<List>(v);
-                int idx = static_cast<int>(std::get<double>(idxv));
-                if (idx < 0) idx = 0;
-                if (idx > static_cast<int>(lst->elements.size())) idx = lst->elements.size();
-                Value elem = evaluate(call->arguments[2].get(), env);
-                lst->elements.insert(lst->elements.begin() + idx, elem);
-                return NullType{};
+            return value;
+        }
+        // присваивание элементу: сначала значение, затем контейнер и индекс
+        case NodeKind::IndexAssign: {
+            auto assign = static_cast<const IndexAssignNode*>(node);
+            auto value = evaluate(assign->value.get(), env);
+            auto container_val = evaluate(assign->container.get(), env);
+            auto idx_val = evaluate(assign->index.get(), env);
+            return assign_element(assign, container_val, idx_val, std::move(value));
+        }
+        // индексация
+        case NodeKind::Index: {
+            auto index = static_cast<const IndexNode*>(node);
+            auto container_val = evaluate(index->str.get(), env);
+            auto idx_val = evaluate(index->index.get(), env);
+            if (std::holds_alternative<Map>(container_val)) {
+                if (!is_hashable(idx_val)) throw std::runtime_error("Ключ словаря должен быть числом или строкой");
+                const Value* found = std::get<Map>(container_val)->table.find(idx_val);
+                return found ? *found : Value(NullType{});
             }
-            if (name == "remove" && call->arguments.size() == 2) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                auto idxv = evaluate(call->arguments[1].get(), env);
-                if (!std::holds_alternative<List>(v) || !std::holds_alternative<double>(idxv)) throw std::runtime_error("Аргументы remove() должны быть списком и индексом");
-                List lst = std::get<List>(v);
-                int idx = static_cast<int>(std::get<double>(idxv));
-                if (idx < 0 || idx >= static_cast<int>(lst->elements.size())) return NullType{};
-                Value val = lst->elements[idx];
-                lst->elements.erase(lst->elements.begin() + idx);
-                return val;
+            if (!std::holds_alternative<double>(idx_val)) {
+                throw std::runtime_error("Индекс должен быть числом");
             }
-            if (name == "sort" && call->arguments.size() == 1) {
-                auto v = evaluate(call->arguments[0].get(), env);
-                if (!std::holds_alternative<List>(v)) throw std::runtime_error("Аргумент sort() должен быть списком");
-                List lst = std::get<List>(v);
-                bool allNum = true;
-                for (auto &e : lst->elements) if (!std::holds_alternative<double>(e)) { allNum = false; break; }
-                if (allNum) {
-                    std::sort(lst->elements.begin(), lst->elements.end(), [](const Value&a,const Value&b){return std::get<double>(a)<std::get<double>(b);});
-                } else {
-                    bool allStr = true;
-                    for (auto &e : lst->elements) if (!std::holds_alternative<std::string>(e)){ allStr=false; break; }
-                    if (allStr) {
-                        std::sort(lst->elements.begin(), lst->elements.end(), [](const Value&a,const Value&b){return std::get<std::string>(a)<std::get<std::string>(b);});
-                    }
+            int64_t idx = to_index(std::get<double>(idx_val));
+            if (std::holds_alternative<Str>(container_val)) {
+                const Str& str = std::get<Str>(container_val);
+                int64_t len = static_cast<int64_t>(str.size());
+                if (idx < 0) idx = len + idx;
+                if (idx < 0 || idx >= len) {
+                    return NullType{};
+                }
+                return Str::from_char(str[idx]);
+            } else if (std::holds_alternative<List>(container_val)) {
+                const List& list = std::get<List>(container_val);
+                int64_t len = static_cast<int64_t>(list->size());
+                if (idx < 0) idx = len + idx;
+                if (idx < 0 || idx >= len) {
+                    return NullType{};
+                }
+                return list->get(idx);
+            } else if (std::holds_alternative<Array>(container_val)) {
+                const auto& data = std::get<Array>(container_val)->data;
+                int64_t len = static_cast<int64_t>(data.size());
+                if (idx < 0) idx = len + idx;
+                if (idx < 0 || idx >= len) {
+                    return NullType{};
                 }
-                return NullType{};
+                return data[idx];
+            } else {
+                throw std::runtime_error("Операция индексации требует строку, список, массив или словарь");
             }
-            // вызов пользовательской функции
-            try {
-                Value fn_val = env.get(name);
-                if (std::holds_alternative<Function>(fn_val)) {
-                    auto f = std::get<Function>(fn_val);
-                    if (call->arguments.size() != f->parameters.size()) {
-                        throw std::runtime_error("Несоответствие количества аргументов");
+        }
+        // срез
+        case NodeKind::Slice: {
+            auto slice = static_cast<const SliceNode*>(node);
+            auto container_val = evaluate(slice->str.get(), env);
+            if (std::holds_alternative<Str>(container_val)) {
+                const Str& str = std::get<Str>(container_val);
+                int64_t len = static_cast<int64_t>(str.size());
+                int64_t start = 0;
+                int64_t end = len;
+                if (slice->start) {
+                    auto start_val = evaluate(slice->start.get(), env);
+                    if (!std::holds_alternative<double>(start_val)) {
+                        throw std::runtime_error("Индексы среза должны быть числами");
                     }
-                    std::vector<Value> args;
-                    for (const auto& arg : call->arguments) {
-                        args.push_back(evaluate(arg.get(), env));
+                    start = to_index(std::get<double>(start_val));
+                    if (start < 0) {
+                        start = len + start;
                     }
-                    Environment local_env;
-                    for (size_t i = 0; i < f->parameters.size() && i < args.size(); ++i) {
-                        local_env.set(f->parameters[i], args[i]);
+                }
+                if (slice->end) {
+                    auto end_val = evaluate(slice->end.get(), env);
+                    if (!std::holds_alternative<double>(end_val)) {
+                        throw std::runtime_error("Индексы среза должны быть числами");
                     }
-                    try {
-                        for (const auto* stmt : f->body) {
-                            execNode(stmt, local_env, *g_print_values);
-                        }
-                    } catch (const ReturnException& re) {
-                        return re.value;
+                    end = to_index(std::get<double>(end_val));
+                    if (end < 0) {
+                        end = len + end;
                     }
-                    return NullType{};
-                }
-            } catch (const std::exception&) {
-            }
-        }
-        // вызов функции через значение
-        {
-            Value calleeVal = evaluate(call->callee.get(), env);
-            if (std::holds_alternative<Function>(calleeVal)) {
-                auto f = std::get<Function>(calleeVal);
-                if (call->arguments.size() != f->parameters.size()) {
-                    throw std::runtime_error("Несоответствие количества аргументов");
                 }
-                std::vector<Value> args;
-                for (const auto& arg : call->arguments) {
-                    args.push_back(evaluate(arg.get(), env));
+                start = std::clamp<int64_t>(start, 0, len);
+                end = std::clamp<int64_t>(end, 0, len);
+                if (start > end) {
+                    return Str();
                 }
-                Environment local_env;
-                for (size_t i = 0; i < f->parameters.size(); ++i) {
-                    local_env.set(f->parameters[i], args[i]);
+                return str.substr(start, end - start);
+            } else if (std::holds_alternative<List>(container_val) || std::holds_alternative<Array>(container_val)) {
+                const List* list = std::get_if<List>(&container_val);
+                int64_t len = static_cast<int64_t>(list ? (*list)->size() : std::get<Array>(container_val)->data.size());
+                int64_t start = 0;
+                int64_t end = len;
+                if (slice->start) {
+                    auto start_val = evaluate(slice->start.get(), env);
+                    if (!std::holds_alternative<double>(start_val)) {
+                        throw std::runtime_error("Индексы среза должны быть числами");
+                    }
+                    start = to_index(std::get<double>(start_val));
+                    if (start < 0) {
+                        start = len + start;
+                    }
                 }
-                try {
-                    for (const auto* stmt : f->body) {
-                        execNode(stmt, local_env, *g_print_values);
+                if (slice->end) {
+                    auto end_val = evaluate(slice->end.get(), env);
+                    if (!std::holds_alternative<double>(end_val)) {
+                        throw std::runtime_error("Индексы среза должны быть числами");
+                    }
+                    end = to_index(std::get<double>(end_val));
+                    if (end < 0) {
+                        end = len + end;
                     }
-                } catch (const ReturnException& re) {
-                    return re.value;
                 }
-                return NullType{};
+                start = std::clamp<int64_t>(start, 0, len);
+                end = std::clamp<int64_t>(end, 0, len);
+                if (list) return (*list)->slice(start, end);
+                // срез массива - новый массив с копией элементов
+                const auto& data = std::get<Array>(container_val)->data;
+                auto result = std::make_shared<ArrayValue>();
+                if (start < end) result->data.assign(data.begin() + start, data.begin() + end);
+                return result;
+            } else {
+                throw std::runtime_error("Операция среза требует строку, список или массив");
             }
         }
-        throw std::runtime_error("Неизвестный вызов функции");
+        // печать
+        case NodeKind::Print: {
+            auto print = static_cast<const PrintNode*>(node);
+            return evaluate(print->expr.get(), env);
+        }
+        default:
+            break;
     }
-    // создание списка
-    if (auto listNode = dynamic_cast<const ListNode*>(node)) {
-        auto result = std::make_shared<ListValue>();
-        for (const auto& elem : listNode->elements) {
-            auto value = evaluate(elem.get(), env);
-            result->elements.push_back(value);
+    throw std::runtime_error("Неизвестный тип узла");
+}
+
+// кэши инвариантов цикла сбрасываются при входе в цикл и восстанавливаются при выходе:
+// рекурсивный вызов функции может снова войти в тот же цикл, не закончив внешний
+class InvariantScope {
+public:
+    explicit InvariantScope(const std::vector<const InvariantNode*>& invariants) : invariants_(invariants) {
+        if (invariants_.empty()) return;
+        saved_.reserve(invariants_.size());
+        for (const auto* invariant : invariants_) {
+            saved_.push_back(std::move(*invariant->cache));
+            *invariant->cache = InvariantCache{};
         }
-        return result;
     }
-    // получение переменной
-    if (auto var = dynamic_cast<const VariableNode*>(node)) {
-        return env.get(var->name);
-    }
-    // бинарная операция
-    if (auto binary = dynamic_cast<const BinaryOpNode*>(node)) {
-        auto left = evaluate(binary->left.get(), env);
-        auto right = evaluate(binary->right.get(), env);
-        return apply_binary_op(left, right, binary->op);
-    }
-    // унарная операция
-    if (auto unary = dynamic_cast<const UnaryOpNode*>(node)) {
-        auto operand = evaluate(unary->operand.get(), env);
-        return apply_unary_op(unary->op, operand);
-    }
-    // присваивание
-    if (auto assign = dynamic_cast<const AssignNode*>(node)) {
-        auto value = evaluate(assign->value.get(), env);
-        if (assign->op == TokenType::EQUALS) {
-            env.set(assign->var_name, value);
-        } else {
-            auto current = env.get(assign->var_name);
-            TokenType op = get_binary_op_from_compound_assign(assign->op);
-            value = apply_binary_op(current, value, op);
-            env.set(assign->var_name, value);
-        }
-        return value;
-    }
-    // индексация
-    if (auto index = dynamic_cast<const IndexNode*>(node)) {
-        auto container_val = evaluate(index->str.get(), env);
-        auto idx_val = evaluate(index->index.get(), env);
-        if (!std::holds_alternative<double>(idx_val)) {
-            throw std::runtime_error("Индекс должен быть числом");
-        }
-        int idx = static_cast<int>(std::get<double>(idx_val));
-        if (std::holds_alternative<std::string>(container_val)) {
-            const std::string& str = std::get<std::string>(container_val);
-            int len = static_cast<int>(str.length());
-            if (idx < 0) idx = len + idx;
-            if (idx < 0 || idx >= len) {
-                return NullType{};
-            }
-            return std::string(1, str[idx]);
-        } else if (std::holds_alternative<List>(container_val)) {
-            const List& list = std::get<List>(container_val);
-            int len = static_cast<int>(list->elements.size());
-            if (idx < 0) idx = len + idx;
-            if (idx < 0 || idx >= len) {
-                return NullType{};
-            }
-            return list->elements[idx];
+    ~InvariantScope() {
+        for (size_t i = 0; i < saved_.size(); ++i) *invariants_[i]->cache = std::move(saved_[i]);
+    }
+
+private:
+    const std::vector<const InvariantNode*>& invariants_;
+    std::vector<InvariantCache> saved_;
+};
+
+// выполнение блока до первой инструкции, прерывающей его
+static Flow exec_block(const std::vector<std::unique_ptr<ASTNode>>& block, Environment& env,
+                       std::vector<Value>& print_values, Value& returned) {
+    for (const auto& stmt : block) {
+        Flow flow = exec_statement(stmt.get(), env, print_values, returned);
+        if (flow != Flow::Normal) return flow;
+    }
+    return Flow::Normal;
+}
+
+// хвостовой вызов из g_tail_call там, где нет кадра, который он мог бы занять
+static Value call_pending_tail_call(Environment& env) {
+    Function f = std::move(g_tail_call.function);
+    CallFrame frame(frame_size(*f));
+    for (size_t i = 0; i < g_tail_call.args.size(); ++i) frame.slots()[i] = std::move(g_tail_call.args[i]);
+    g_tail_call.args.clear();
+    return invoke(f, frame, env, g_tail_call.line);
+}
+
+// обход значения циклом for: список и массив - по индексу, без копии (изменения в теле цикла
+// видны обходу), множество - по снимку элементов, итератор - по одному элементу
+class ForIteration {
+public:
+    explicit ForIteration(Value iterable) : iterable_(std::move(iterable)) {
+        if (auto set = std::get_if<Set>(&iterable_)) {
+            // снимок: изменение множества в теле цикла безопасно
+            auto snapshot = make_ref<ListValue>();
+            (*set)->table.for_each([&](const Value& elem, const NoValue&) { snapshot->push(elem); });
+            iterable_ = snapshot;
+        }
+        if (auto list = std::get_if<List>(&iterable_)) {
+            list_ = list->get();
+        } else if (auto array = std::get_if<Array>(&iterable_)) {
+            array_ = array->get();
+        } else if (auto iterator = std::get_if<Iterator>(&iterable_)) {
+            iterator_ = iterator->get();
         } else {
-            throw std::runtime_error("Операция индексации требует строку или список");
-        }
-    }
-    // срез
-    if (auto slice = dynamic_cast<const SliceNode*>(node)) {
-        auto container_val = evaluate(slice->str.get(), env);
-        if (std::holds_alternative<std::string>(container_val)) {
-            const std::string& str = std::get<std::string>(container_val);
-            int len = static_cast<int>(str.length());
-            int start = 0;
-            int end = len;
-            if (slice->start) {
-                auto start_val = evaluate(slice->start.get(), env);
-                if (!std::holds_alternative<double>(start_val)) {
-                    throw std::runtime_error("Индексы среза должны быть числами");
-                }
-                start = static_cast<int>(std::get<double>(start_val));
-                if (start < 0) {
-                    start = len + start;
-                }
-            }
-            if (slice->end) {
-                auto end_val = evaluate(slice->end.get(), env);
-                if (!std::holds_alternative<double>(end_val)) {
-                    throw std::runtime_error("Индексы среза должны быть числами");
-                }
-                end = static_cast<int>(std::get<double>(end_val));
-                if (end < 0) {
-                    end = len + end;
-                }
+            throw std::runtime_error("Итерируемый объект цикла for должен быть списком, массивом, множеством или итератором");
+        }
+    }
+
+    bool next(Value& item) {
+        if (list_) {
+            if (index_ >= list_->size()) return false;
+            item = list_->get(index_++);
+            return true;
+        }
+        if (array_) {
+            if (index_ >= array_->data.size()) return false;
+            item = array_->data[index_++];
+            return true;
+        }
+        return iterator_->next(item);
+    }
+
+private:
+    Value iterable_; // удерживает обходимое значение
+    const ListValue* list_ = nullptr;
+    const ArrayValue* array_ = nullptr;
+    IteratorValue* iterator_ = nullptr;
+    size_t index_ = 0;
+};
+
+// генератор: вызов функции с yield, тело которой выполняется по частям при обходе.
+// вместо стека C++ позицию выполнения хранят собственный кадр и стек блоков (тело функции,
+// ветви if, тела циклов), поэтому на yield генератор приостанавливается без потоков.
+// инструкции без yield выполняются обычным exec_statement целиком
+class Generator : public IteratorValue {
+public:
+    Generator(Function function, Value* args, Environment& env)
+        : function_(std::move(function)), slots_(frame_size(*function_), unbound_value()), globals_(&env.globals()) {
+        for (size_t i = 0; i < function_->parameters.size(); ++i) slots_[i] = std::move(args[i]);
+        blocks_.push_back({&function_->node->body, 0, nullptr, std::nullopt});
+    }
+
+    bool next(Value& out) override {
+        if (running_) throw std::runtime_error("Генератор уже выполняется");
+        if (blocks_.empty()) return false;
+        running_ = true;
+        CallRecordGuard record(function_->node, 0);
+        Environment env(slots_.data(), *globals_);
+        bool produced;
+        try {
+            produced = resume(env, out);
+        } catch (const TracedError&) {
+            finish();
+            throw;
+        } catch (const std::runtime_error& e) {
+            finish();
+            throw TracedError(e.what() + format_call_stack());
+        }
+        running_ = false;
+        if (!produced) finish();
+        return produced;
+    }
+
+private:
+    struct Block {
+        const std::vector<std::unique_ptr<ASTNode>>* statements;
+        size_t next;                          // следующая инструкция
+        const ASTNode* loop;                  // цикл, тело которого выполняется, или nullptr
+        std::optional<ForIteration> iteration; // обход цикла for
+    };
+
+    // выполнение до следующего yield; false, если тело функции завершилось
+    bool resume(Environment& env, Value& out) {
+        Value returned;
+        while (!blocks_.empty()) {
+            Block& block = blocks_.back();
+            if (block.next == block.statements->size()) {
+                if (!repeat_loop(block, env)) blocks_.pop_back();
+                continue;
             }
-            start = std::max(0, std::min(start, len));
-            end = std::max(0, std::min(end, len));
-            if (start > end) {
-                return std::string();
+            const ASTNode* stmt = (*block.statements)[block.next++].get();
+            if (!stmt->suspends) {
+                Flow flow = exec_statement(stmt, env, *g_print_values, returned);
+                if (flow != Flow::Normal && !unwind(flow, env)) return false;
+                continue;
             }
-            return str.substr(start, end - start);
-        } else if (std::holds_alternative<List>(container_val)) {
-            const List& list = std::get<List>(container_val);
-            int len = static_cast<int>(list->elements.size());
-            int start = 0;
-            int end = len;
-            if (slice->start) {
-                auto start_val = evaluate(slice->start.get(), env);
-                if (!std::holds_alternative<double>(start_val)) {
-                    throw std::runtime_error("Индексы среза должны быть числами");
-                }
-                start = static_cast<int>(std::get<double>(start_val));
-                if (start < 0) {
-                    start = len + start;
+            switch (stmt->kind) {
+                case NodeKind::Yield:
+                    out = evaluate(static_cast<const YieldNode*>(stmt)->expr.get(), env);
+                    return true;
+                case NodeKind::If: {
+                    auto ifNode = static_cast<const IfNode*>(stmt);
+                    const auto* chosen = &ifNode->else_branch;
+                    for (const auto& branch : ifNode->branches) {
+                        if (isTruthy(evaluate(branch.first.get(), env))) {
+                            chosen = &branch.second;
+                            break;
+                        }
+                    }
+                    blocks_.push_back({chosen, 0, nullptr, std::nullopt});
+                    break;
                 }
-            }
-            if (slice->end) {
-                auto end_val = evaluate(slice->end.get(), env);
-                if (!std::holds_alternative<double>(end_val)) {
-                    throw std::runtime_error("Индексы среза должны быть числами");
+                // тело цикла начинается с проверки продолжения, как после очередной итерации
+                case NodeKind::For: {
+                    auto forNode = static_cast<const ForNode*>(stmt);
+                    ForIteration iteration(evaluate(forNode->iterable.get(), env));
+                    blocks_.push_back({&forNode->body, forNode->body.size(), forNode, std::move(iteration)});
+                    break;
                 }
-                end = static_cast<int>(std::get<double>(end_val));
-                if (end < 0) {
-                    end = len + end;
+                case NodeKind::While: {
+                    auto whileNode = static_cast<const WhileNode*>(stmt);
+                    blocks_.push_back({&whileNode->body, whileNode->body.size(), whileNode, std::nullopt});
+                    break;
                 }
+                default:
+                    throw std::runtime_error("yield вне генератора");
             }
-            start = std::max(0, std::min(start, len));
-            end = std::max(0, std::min(end, len));
-            if (start > end) {
-                return std::make_shared<ListValue>();
-            }
-            auto result = std::make_shared<ListValue>();
-            result->elements.insert(result->elements.end(), list->elements.begin() + start, list->elements.begin() + end);
-            return result;
+        }
+        return false;
+    }
+
+    // следующая итерация цикла, тело которого выполнено; false, если цикл завершен
+    bool repeat_loop(Block& block, Environment& env) {
+        if (!block.loop) return false;
+        if (block.loop->kind == NodeKind::For) {
+            auto forNode = static_cast<const ForNode*>(block.loop);
+            Value item;
+            if (!block.iteration->next(item)) return false;
+            write_variable(forNode->slot, forNode->var_name, std::move(item), env);
         } else {
-            throw std::runtime_error("Операция среза требует строку или список");
+            auto whileNode = static_cast<const WhileNode*>(block.loop);
+            if (!isTruthy(evaluate(whileNode->condition.get(), env))) return false;
         }
+        block.next = 0;
+        return true;
     }
-    // печать
-    if (auto print = dynamic_cast<const PrintNode*>(node)) {
-        return evaluate(print->expr.get(), env);
+
+    // break, continue и return из инструкции блока; false, если тело функции завершилось
+    bool unwind(Flow flow, Environment& env) {
+        switch (flow) {
+            case Flow::Break:
+            case Flow::Continue:
+                while (!blocks_.empty() && !blocks_.back().loop) blocks_.pop_back();
+                if (blocks_.empty()) throw std::runtime_error(flow == Flow::Break ? "break вне цикла" : "continue вне цикла");
+                if (flow == Flow::Break) {
+                    blocks_.pop_back();
+                } else {
+                    blocks_.back().next = blocks_.back().statements->size();
+                }
+                return true;
+            case Flow::TailCall:
+                call_pending_tail_call(env); // значение return в генераторе не используется
+                return false;
+            default:
+                return false;
+        }
     }
-    throw std::runtime_error("Неизвестный тип узла");
+
+    // генератор исчерпан: кадр освобождается сразу, а не вместе с итератором
+    void finish() {
+        running_ = false;
+        blocks_.clear();
+        slots_.clear();
+    }
+
+    Function function_;
+    std::vector<Value> slots_;
+    Environment* globals_;
+    std::vector<Block> blocks_;
+    bool running_ = false;
+};
+
+static Value make_generator(const Function& f, Value* args, Environment& env) {
+    return Iterator(std::make_shared<Generator>(f, args, env));
 }
 
 // выполнение узла
 void execNode(const ASTNode* node, Environment& env, std::vector<Value>& print_values) { // выполняет узел AST, изменяя среду выполнения или добавляя значения в print_values.
-    if (auto retNode = dynamic_cast<const ReturnNode*>(node)) {
-        Value val = evaluate(retNode->expr.get(), env);
-        throw ReturnException{val};
-    }
-    if (auto call = dynamic_cast<const CallNode*>(node)) {
-        if (auto fn = dynamic_cast<const VariableNode*>(call->callee.get())) {
-            const std::string& name = fn->name;
-            // функции print и println
-            if (name == "print" && call->arguments.size() == 1) {
-                auto value = evaluate(call->arguments[0].get(), env);
-                print_values.push_back(value);
-                return;
-            }
-            if (name == "println" && call->arguments.size() == 1) {
-                auto value = evaluate(call->arguments[0].get(), env);
-                print_values.push_back(value);
-                print_values.push_back(std::string("\n"));
-                return;
+    Value returned;
+    switch (exec_statement(node, env, print_values, returned)) {
+        case Flow::Normal: return;
+        case Flow::Return: throw ReturnException{std::move(returned)};
+        case Flow::TailCall:
+            // return f(...) вне функции: вызов выполняется обычным образом
+            throw ReturnException{call_pending_tail_call(env)};
+        case Flow::Break: throw BreakException();
+        case Flow::Continue: throw ContinueException();
+    }
+}
+
+// return, break и continue не бросают исключений: они возвращают Flow, и объемлющие
+// циклы и вызов функции обрабатывают его; returned - значение return
+static Flow exec_statement(const ASTNode* node, Environment& env, std::vector<Value>& print_values, Value& returned) {
+    collect_cycles_if_requested();
+    switch (node->kind) {
+        // возврат из функции
+        case NodeKind::Return: {
+            auto retNode = static_cast<const ReturnNode*>(node);
+            if (auto call = as_call(retNode->expr.get())) {
+                auto fn = as_variable(call->callee.get());
+                if (!fn || is_bound(fn, env)) { // встроенные функции вызываются как обычно
+                    Value callee = evaluate(call->callee.get(), env);
+                    if (!std::holds_alternative<Function>(callee)) throw std::runtime_error("Неизвестный вызов функции");
+                    const Function& f = std::get<Function>(callee);
+                    if (call->arguments.size() != f->parameters.size()) {
+                        throw std::runtime_error("Несоответствие количества аргументов");
+                    }
+                    // аргументы вычисляются во временные ячейки: вложенные вызовы внутри аргументов
+                    // сами могут пользоваться g_tail_call
+                    CallFrame scratch(call->arguments.size());
+                    for (size_t i = 0; i < call->arguments.size(); ++i) {
+                        scratch.slots()[i] = evaluate(call->arguments[i].get(), env);
+                    }
+                    g_tail_call.function = f;
+                    g_tail_call.line = call->line;
+                    for (size_t i = 0; i < call->arguments.size(); ++i) {
+                        g_tail_call.args.push_back(std::move(scratch.slots()[i]));
+                    }
+                    return Flow::TailCall;
+                }
             }
+            returned = evaluate(retNode->expr.get(), env);
+            return Flow::Return;
         }
-    }
-    // прерывание цикла
-    if (dynamic_cast<const BreakNode*>(node)) {
-        throw BreakException();
-    }
-    // продолжение цикла
-    if (dynamic_cast<const ContinueNode*>(node)) {
-        throw ContinueException();
-    }
-    // обработка печати
-    if (auto printNode = dynamic_cast<const PrintNode*>(node)) {
-        if (auto lit = dynamic_cast<const StringNode*>(printNode->expr.get())) {
-            auto rawVal = evaluate(printNode->expr.get(), env);
-            if (!std::holds_alternative<std::string>(rawVal)) {
-                throw std::runtime_error("Ожидался строковый литерал");
+        // вызов функции как инструкция
+        case NodeKind::Call: {
+            auto call = static_cast<const CallNode*>(node);
+            if (auto fn = as_variable(call->callee.get())) {
+                const std::string& name = fn->name;
+                // функции print и println
+                if (name == "print" && call->arguments.size() == 1) {
+                    auto value = evaluate(call->arguments[0].get(), env);
+                    print_values.push_back(value);
+                    return Flow::Normal;
+                }
+                if (name == "println" && call->arguments.size() == 1) {
+                    auto value = evaluate(call->arguments[0].get(), env);
+                    print_values.push_back(value);
+                    print_values.push_back(Str::from_char('\n'));
+                    return Flow::Normal;
+                }
             }
-            const std::string raw = std::get<std::string>(rawVal);
-            std::string out = raw;
-            if (raw.find(' ') != std::string::npos) {
-                out = std::string("\"") + raw + "\"";
+            evaluate(node, env);
+            return Flow::Normal;
+        }
+        // прерывание цикла
+        case NodeKind::Break:
+            return Flow::Break;
+        // продолжение цикла
+        case NodeKind::Continue:
+            return Flow::Continue;
+        // обработка печати
+        case NodeKind::Print: {
+            auto printNode = static_cast<const PrintNode*>(node);
+            if (printNode->expr->kind == NodeKind::String) {
+                auto rawVal = evaluate(printNode->expr.get(), env);
+                if (!std::holds_alternative<Str>(rawVal)) {
+                    throw std::runtime_error("Ожидался строковый литерал");
+                }
+                const Str raw = std::get<Str>(rawVal);
+                Str out = raw;
+                if (raw.view().find(' ') != std::string_view::npos) {
+                    out = "\"" + raw.str() + "\"";
+                }
+                print_values.push_back(out);
+            } else {
+                auto value = evaluate(printNode->expr.get(), env);
+                print_values.push_back(value);
             }
-            print_values.push_back(out);
-        } else {
-            auto value = evaluate(printNode->expr.get(), env);
-            print_values.push_back(value);
+            return Flow::Normal;
         }
-    } else if (auto assignNode = dynamic_cast<const AssignNode*>(node)) {
-        evaluate(assignNode, env);
-    } else if (auto ifNode = dynamic_cast<const IfNode*>(node)) {
         // условный оператор
-        bool executed = false;
-        for (const auto& branch : ifNode->branches) {
-            Value cond = evaluate(branch.first.get(), env);
-            if (isTruthy(cond)) {
-                for (const auto& stmt : branch.second) execNode(stmt.get(), env, print_values);
-                executed = true;
-                break;
+        case NodeKind::If: {
+            auto ifNode = static_cast<const IfNode*>(node);
+            for (const auto& branch : ifNode->branches) {
+                Value cond = evaluate(branch.first.get(), env);
+                if (isTruthy(cond)) return exec_block(branch.second, env, print_values, returned);
             }
+            return exec_block(ifNode->else_branch, env, print_values, returned);
         }
-        if (!executed) {
-            for (const auto& stmt : ifNode->else_branch) execNode(stmt.get(), env, print_values);
-        }
-    } else if (auto forNode = dynamic_cast<const ForNode*>(node)) {
         // цикл for
-        Value iterable = evaluate(forNode->iterable.get(), env);
-        if (!std::holds_alternative<List>(iterable)) throw std::runtime_error("Итерируемый объект цикла for должен быть списком");
-        const List& listVal = std::get<List>(iterable);
-        for (const auto& elem : listVal->elements) {
-            env.set(forNode->var_name, elem);
-            try {
-                for (const auto& stmt : forNode->body) execNode(stmt.get(), env, print_values);
-            } catch (const ContinueException&) {
-                continue;
-            } catch (const BreakException&) {
-                break;
+        case NodeKind::For: {
+            auto forNode = static_cast<const ForNode*>(node);
+            ForIteration iteration(evaluate(forNode->iterable.get(), env));
+            InvariantScope invariants(forNode->invariants);
+            Value item;
+            while (iteration.next(item)) {
+                write_variable(forNode->slot, forNode->var_name, std::move(item), env);
+                Flow flow = exec_block(forNode->body, env, print_values, returned);
+                if (flow == Flow::Break) break;
+                if (flow == Flow::Return || flow == Flow::TailCall) return flow;
             }
+            return Flow::Normal;
         }
-    } else if (auto whileNode = dynamic_cast<const WhileNode*>(node)) {
+        // yield выполняет только генератор (Generator::resume)
+        case NodeKind::Yield:
+            throw std::runtime_error("yield вне генератора");
         // цикл while
-        while (true) {
-            Value cond = evaluate(whileNode->condition.get(), env);
-            if (!isTruthy(cond)) break;
-            try {
-                for (const auto& stmt : whileNode->body) execNode(stmt.get(), env, print_values);
-            } catch (const ContinueException&) {
-                continue;
-            } catch (const BreakException&) {
-                break;
+        case NodeKind::While: {
+            auto whileNode = static_cast<const WhileNode*>(node);
+            InvariantScope invariants(whileNode->invariants);
+            while (true) {
+                Value cond = evaluate(whileNode->condition.get(), env);
+                if (!isTruthy(cond)) break;
+                Flow flow = exec_block(whileNode->body, env, print_values, returned);
+                if (flow == Flow::Break) break;
+                if (flow == Flow::Return || flow == Flow::TailCall) return flow;
             }
+            return Flow::Normal;
         }
-    } else {
-        evaluate(node, env);
+        default:
+            // присваивание и другие выражения
+            evaluate(node, env);
+            return Flow::Normal;
     }
-}
\ No newline at end of file
+}
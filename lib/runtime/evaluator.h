@@ -5,4 +5,6 @@
 #include <vector>
 
 Value evaluate(const ASTNode* node, Environment& env); // вычисление значения узла АСТ
-void execNode(const ASTNode* node, Environment& env, std::vector<Value>& print_values); // выполнение узла АСТ 
\ No newline at end of file
+void execNode(const ASTNode* node, Environment& env, std::vector<Value>& print_values); // выполнение узла АСТ 
+Value call_function(const Function& f, std::vector<Value> args, Environment& env); // вызов пользовательской функции с готовыми аргументами из среды env
+void set_call_depth_limit(size_t depth); // максимальная глубина вложенных вызовов пользовательских функций
@@ -0,0 +1,202 @@
+#include "file_io.h"
+#include "line_reader.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define DFS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t kWriteBufferSize = 1 << 20;
+constexpr size_t kMapThreshold = 1 << 20; // меньшие файлы дешевле прочитать потоком
+
+// писатель с крупным буфером: множество мелких append_file превращается в редкие системные вызовы
+struct FileWriter {
+    FILE* file = nullptr;
+    std::unique_ptr<char[]> buffer;
+
+    FileWriter(const std::string& path, bool append) {
+        file = std::fopen(path.c_str(), append ? "ab" : "wb");
+        if (!file) throw std::runtime_error("Не удалось открыть файл для записи: " + path);
+        buffer.reset(new char[kWriteBufferSize]);
+        std::setvbuf(file, buffer.get(), _IOFBF, kWriteBufferSize);
+    }
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+    ~FileWriter() {
+        std::fclose(file);
+    }
+
+    void write(std::string_view data) {
+        if (std::fwrite(data.data(), 1, data.size(), file) != data.size()) {
+            throw std::runtime_error("Ошибка записи в файл");
+        }
+    }
+};
+
+#ifdef DFS_MMAP
+// файл, отображенный в память только для чтения; живет, пока на него ссылаются строки
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+};
+
+// строки отображенного файла; страницы подгружаются ядром по мере обхода
+class MappedLinesIterator : public IteratorValue {
+public:
+    explicit MappedLinesIterator(std::shared_ptr<MappedFile> file)
+        : file_(file), chars_(file, file->data) {}
+
+    bool next(Value& out) override {
+        size_t size = file_->size;
+        if (pos_ >= size) return false;
+        const char* begin = file_->data;
+        auto newline = static_cast<const char*>(std::memchr(begin + pos_, '\n', size - pos_));
+        size_t end = newline ? newline - begin : size;
+        size_t length = end - pos_;
+        if (length > 0 && begin[end - 1] == '\r') --length;
+        out = Str(chars_, pos_, length);
+        pos_ = end + 1;
+        if (pos_ - dropped_ >= kDropStep) {
+            // пройденные страницы освобождаются: сохраненные строки при обращении
+            // перечитают их из файла, поэтому память не растет с размером файла
+            madvise(const_cast<char*>(begin) + dropped_, kDropStep, MADV_DONTNEED);
+            dropped_ += kDropStep;
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t kDropStep = 64 << 20; // кратно размеру страницы
+
+    std::shared_ptr<MappedFile> file_;
+    std::shared_ptr<const char> chars_; // символы отображения с владельцем file_
+    size_t pos_ = 0;
+    size_t dropped_ = 0;
+};
+#endif
+
+// строки файла, читаемого потоком: для маленьких файлов и систем без mmap
+class StreamLinesIterator : public IteratorValue {
+public:
+    explicit StreamLinesIterator(const std::string& path)
+        : file_(std::make_unique<std::ifstream>(path, std::ios::binary)), lines_(std::make_shared<LineReader>(*file_)) {}
+
+    bool good() const { return file_->is_open(); }
+    bool next(Value& out) override { return lines_.next(out); }
+
+private:
+    std::unique_ptr<std::ifstream> file_;
+    LinesIterator lines_;
+};
+
+// писатели и отображения хранятся по каноническому пути, чтобы "a.txt" и "./a.txt"
+// были одним файлом. состояние свое у каждого потока: интерпретаторы в разных потоках независимы
+struct FileState {
+    std::unordered_map<std::string, std::string> keys; // путь из скрипта -> канонический путь
+    std::unordered_map<std::string, std::unique_ptr<FileWriter>> writers;
+#ifdef DFS_MMAP
+    std::unordered_map<std::string, std::weak_ptr<MappedFile>> mappings;
+#endif
+};
+
+FileState& files() {
+    thread_local FileState state;
+    return state;
+}
+
+// канонический путь вычисляется один раз для каждой строки пути: частые append_file
+// с одним путем не обращаются к файловой системе
+const std::string& key_of(const std::string& path) {
+    auto& keys = files().keys;
+    auto it = keys.find(path);
+    if (it == keys.end()) {
+        std::error_code error;
+        auto canonical = std::filesystem::weakly_canonical(path, error);
+        it = keys.emplace(path, error ? path : canonical.string()).first;
+    }
+    return it->second;
+}
+
+// записанное, но еще не сброшенное на диск должно быть видно при чтении. сбрасываются
+// все писатели (их немного): так видны и записи в тот же файл под другим именем (жесткая ссылка)
+void flush_writers() {
+    for (auto& entry : files().writers) std::fflush(entry.second->file);
+}
+
+} // namespace
+
+Str read_file(const std::string& path) {
+    flush_writers();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) throw std::runtime_error("Не удалось открыть файл: " + path);
+    std::string content(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(content.data(), static_cast<std::streamsize>(content.size()));
+    return Str(std::move(content));
+}
+
+void write_file(const std::string& path, std::string_view data, bool append) {
+    auto& writers = files().writers;
+    const std::string& key = key_of(path);
+    auto it = writers.find(key);
+    if (it == writers.end() || !append) {
+        if (it != writers.end()) writers.erase(it);
+#ifdef DFS_MMAP
+        // отображение, на которое еще ссылаются строки, нельзя усекать: файл
+        // пересоздается, а старое содержимое остается доступным по отображению
+        auto mapped = files().mappings.find(key);
+        if (!append && mapped != files().mappings.end() && !mapped->second.expired()) {
+            unlink(path.c_str());
+        }
+#endif
+        it = writers.emplace(key, std::make_unique<FileWriter>(path, append)).first;
+    }
+    it->second->write(data);
+}
+
+Iterator file_lines(const std::string& path) {
+    flush_writers();
+#ifdef DFS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Не удалось открыть файл: " + path);
+    struct stat info;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= kMapThreshold) {
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) throw std::runtime_error("Не удалось отобразить файл: " + path);
+        madvise(data, info.st_size, MADV_SEQUENTIAL); // прочитанные страницы можно вытеснять
+        auto mapped = std::make_shared<MappedFile>();
+        mapped->data = static_cast<const char*>(data);
+        mapped->size = info.st_size;
+        files().mappings[key_of(path)] = mapped;
+        return std::make_shared<MappedLinesIterator>(mapped);
+    }
+    close(fd);
+#endif
+    auto lines = std::make_shared<StreamLinesIterator>(path);
+    if (!lines->good()) throw std::runtime_error("Не удалось открыть файл: " + path);
+    return lines;
+}
+
+void close_files() {
+    files().writers.clear();
+    files().keys.clear();
+#ifdef DFS_MMAP
+    files().mappings.clear();
+#endif
+}
@@ -0,0 +1,16 @@
+// файловый ввод-вывод
+#pragma once
+#include "types.h"
+#include <string>
+#include <string_view>
+
+// содержимое файла целиком
+Str read_file(const std::string& path);
+// запись через буферизованный писатель, который остается открытым до конца запуска:
+// write_file заменяет содержимое файла, append_file дописывает в конец
+void write_file(const std::string& path, std::string_view data, bool append);
+// ленивый обход строк файла; большой файл отображается в память целиком,
+// а строки - срезы отображения без копирования
+Iterator file_lines(const std::string& path);
+// сброс буферов и закрытие всех писателей в конце запуска
+void close_files();
@@ -0,0 +1,142 @@
+#include "gc.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+thread_local bool g_gc_requested = false;
+
+// регистрация объектов и сборка: пробное удаление по счетчикам ссылок. у каждого потока
+// свой реестр: объекты одного интерпретатора не видны другим потокам, пока не заморожены,
+// а замороженные объекты снимаются с учета (GcObject::untrack)
+class CycleCollector {
+public:
+    // сборка запрашивается, когда с прошлой создано столько объектов, сколько их было
+    // живо после нее, но не меньше kMinThreshold: ее стоимость делится на новые объекты
+    static constexpr size_t kMinThreshold = 10000;
+
+    static void link(GcObject* object) {
+        object->tracked_ = true;
+        object->next_ = head_;
+        if (head_) head_->prev_ = object;
+        head_ = object;
+        ++stats_.tracked;
+        if (++allocated_ >= threshold_) g_gc_requested = true;
+    }
+
+    static void unlink(GcObject* object) {
+        if (!object->tracked_) return;
+        object->tracked_ = false;
+        if (object->prev_) {
+            object->prev_->next_ = object->next_;
+        } else {
+            head_ = object->next_;
+        }
+        if (object->next_) object->next_->prev_ = object->prev_;
+        --stats_.tracked;
+    }
+
+    static size_t collect() {
+        auto start = std::chrono::steady_clock::now();
+        g_gc_requested = false;
+        allocated_ = 0;
+
+        // 1. ссылки, не объяснимые ссылками между объектами, приходят извне. объект без
+        // владельца Ref лежит на стеке C++ и не собирается; замороженные объекты не учитываются
+        // и не обходятся: их могут одновременно читать другие потоки
+        std::vector<GcObject*> children;
+        for (GcObject* object = head_; object; object = object->next_) {
+            object->gc_refs_ = object->use_count() == 0 ? 1 : static_cast<long>(object->use_count());
+        }
+        for (GcObject* object = head_; object; object = object->next_) {
+            children.clear();
+            object->collect_children(children);
+            for (GcObject* child : children) {
+                if (!child->frozen()) --child->gc_refs_;
+            }
+        }
+
+        // 2. все, что достижимо из объектов с внешними ссылками, живо
+        std::vector<GcObject*> pending;
+        for (GcObject* object = head_; object; object = object->next_) {
+            if (object->gc_refs_ > 0) {
+                object->gc_refs_ = kReachable;
+                pending.push_back(object);
+            }
+        }
+        while (!pending.empty()) {
+            GcObject* object = pending.back();
+            pending.pop_back();
+            children.clear();
+            object->collect_children(children);
+            for (GcObject* child : children) {
+                if (!child->frozen() && child->gc_refs_ != kReachable) {
+                    child->gc_refs_ = kReachable;
+                    pending.push_back(child);
+                }
+            }
+        }
+
+        // 3. остальные объекты ссылаются только друг на друга: ссылки между ними разрываются,
+        // а объекты удерживаются до конца разрыва, чтобы не удалить их посреди обхода
+        std::vector<GcObject*> garbage;
+        for (GcObject* object = head_; object; object = object->next_) {
+            if (object->gc_refs_ != kReachable) garbage.push_back(object);
+        }
+        for (GcObject* object : garbage) object->retain();
+        for (GcObject* object : garbage) object->clear_children();
+        for (GcObject* object : garbage) {
+            if (object->release()) delete object;
+        }
+
+        threshold_ = std::max(kMinThreshold, stats_.tracked);
+        double pause = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ++stats_.collections;
+        stats_.collected += garbage.size();
+        stats_.last_pause_ms = pause;
+        stats_.max_pause_ms = std::max(stats_.max_pause_ms, pause);
+        stats_.total_pause_ms += pause;
+        return garbage.size();
+    }
+
+    static const GcStats& stats() { return stats_; }
+
+    static void for_each(const std::function<void(const GcObject*)>& visit) {
+        for (GcObject* object = head_; object; object = object->next_) visit(object);
+    }
+
+private:
+    static constexpr long kReachable = LONG_MIN;
+
+    static thread_local inline GcObject* head_ = nullptr;
+    static thread_local inline size_t allocated_ = 0;
+    static thread_local inline size_t threshold_ = kMinThreshold;
+    static thread_local inline GcStats stats_;
+};
+
+GcObject::GcObject() {
+    CycleCollector::link(this);
+}
+
+GcObject::GcObject(const GcObject& other) : RefCounted(other) {
+    CycleCollector::link(this);
+}
+
+GcObject::~GcObject() {
+    CycleCollector::unlink(this);
+}
+
+void GcObject::untrack() {
+    CycleCollector::unlink(this);
+}
+
+size_t collect_cycles() {
+    return CycleCollector::collect();
+}
+
+const GcStats& gc_stats() {
+    return CycleCollector::stats();
+}
+
+void for_each_tracked(const std::function<void(const GcObject*)>& visit) {
+    CycleCollector::for_each(visit);
+}
@@ -0,0 +1,57 @@
+// сборка циклов ссылок между значениями кучи
+#pragma once
+#include "ref.h"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// объект кучи, который может входить в цикл ссылок: список, хранилище элементов списка, словарь.
+// все такие объекты зарегистрированы, и сборщик находит среди них группы, на которые
+// ссылаются только они сами (пробное удаление: внешние ссылки - из сред, стека значений,
+// локальных переменных C++ - это все, что не объясняется ссылками между объектами)
+class GcObject : public RefCounted {
+public:
+    GcObject();
+    GcObject(const GcObject& other);
+    GcObject& operator=(const GcObject&) { return *this; }
+    virtual ~GcObject();
+
+    // добавляет в out объекты, на которые ссылается этот объект (по одному разу на ссылку)
+    virtual void collect_children(std::vector<GcObject*>& out) const = 0;
+    // освобождает ссылки на другие значения: так сборщик разрывает найденный цикл
+    virtual void clear_children() = 0;
+
+protected:
+    // снятие с учета при заморозке: замороженный объект неизменяем и не может
+    // образовать новый цикл, а удалить его может другой поток
+    void untrack();
+
+private:
+    friend class CycleCollector;
+    bool tracked_ = false;
+    GcObject* prev_ = nullptr;
+    GcObject* next_ = nullptr;
+    long gc_refs_ = 0; // рабочее поле сборки
+};
+
+// статистика сборок для gc_stats()
+struct GcStats {
+    size_t collections = 0;  // число сборок
+    size_t collected = 0;    // освобождено объектов за все сборки
+    size_t tracked = 0;      // зарегистрированных объектов сейчас
+    double last_pause_ms = 0;
+    double max_pause_ms = 0;
+    double total_pause_ms = 0;
+};
+
+size_t collect_cycles(); // полная сборка циклов, возвращает число освобожденных объектов
+const GcStats& gc_stats();
+void for_each_tracked(const std::function<void(const GcObject*)>& visit); // объекты текущего потока
+
+extern thread_local bool g_gc_requested; // с последней сборки создано достаточно новых объектов
+
+// сборка, если она запрошена: вызывается между инструкциями, где все живые значения
+// удерживаются счетчиками ссылок
+inline void collect_cycles_if_requested() {
+    if (g_gc_requested) collect_cycles();
+}
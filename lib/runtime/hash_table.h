@@ -0,0 +1,153 @@
+// хеш-таблица с открытой адресацией для словарей и множеств
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// записи хранятся плотным массивом в порядке вставки, а индекс слотов
+// содержит только номер записи и младшие 32 бита её хеша, поэтому
+// линейное пробирование почти не обращается к самим ключам
+template <typename Key, typename Mapped, typename Hash, typename KeyEqual>
+class HashTable {
+public:
+    struct Entry {
+        size_t hash;  // закешированный хеш ключа, при росте таблицы не пересчитывается
+        Key key;
+        [[no_unique_address]] Mapped value;
+        bool alive;
+    };
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const Mapped* find(const Key& key) const {
+        int32_t index = lookup(key, Hash{}(key));
+        return index < 0 ? nullptr : &entries_[index].value;
+    }
+
+    Mapped* find(const Key& key) {
+        int32_t index = lookup(key, Hash{}(key));
+        return index < 0 ? nullptr : &entries_[index].value;
+    }
+
+    bool contains(const Key& key) const {
+        return lookup(key, Hash{}(key)) >= 0;
+    }
+
+    // возвращает значение по ключу, вставляя значение по умолчанию при отсутствии
+    std::pair<Mapped*, bool> try_emplace(const Key& key) {
+        size_t hash = Hash{}(key);
+        int32_t index = lookup(key, hash);
+        if (index >= 0) {
+            return {&entries_[index].value, false};
+        }
+        if ((entries_.size() + 1) * 4 > slots_.size() * 3) {
+            rehash(size_ + 1);
+        }
+        index = static_cast<int32_t>(entries_.size());
+        entries_.push_back(Entry{hash, key, Mapped{}, true});
+        place(hash, index);
+        ++size_;
+        return {&entries_[index].value, true};
+    }
+
+    bool erase(const Key& key) {
+        if (slots_.empty()) return false;
+        size_t hash = Hash{}(key);
+        size_t mask = slots_.size() - 1;
+        uint32_t tag = static_cast<uint32_t>(hash);
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots_[i];
+            if (slot.index == kEmpty) return false;
+            if (slot.index >= 0 && slot.tag == tag) {
+                Entry& entry = entries_[slot.index];
+                if (entry.hash == hash && KeyEqual{}(entry.key, key)) {
+                    entry.alive = false;
+                    entry.key = Key{};
+                    entry.value = Mapped{};
+                    slot.index = kDeleted;
+                    --size_;
+                    return true;
+                }
+            }
+        }
+    }
+
+    void clear() {
+        entries_.clear();
+        slots_.clear();
+        size_ = 0;
+    }
+
+    void reserve(size_t count) {
+        if (count * 4 > slots_.size() * 3) {
+            rehash(count);
+        }
+    }
+
+    // обход живых записей в порядке вставки
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const auto& entry : entries_) {
+            if (entry.alive) f(entry.key, entry.value);
+        }
+    }
+
+private:
+    static constexpr int32_t kEmpty = -1;
+    static constexpr int32_t kDeleted = -2;
+
+    struct Slot {
+        uint32_t tag;
+        int32_t index;
+    };
+
+    std::vector<Entry> entries_;
+    std::vector<Slot> slots_;  // размер всегда степень двойки
+    size_t size_ = 0;
+
+    int32_t lookup(const Key& key, size_t hash) const {
+        if (slots_.empty()) return -1;
+        size_t mask = slots_.size() - 1;
+        uint32_t tag = static_cast<uint32_t>(hash);
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots_[i];
+            if (slot.index == kEmpty) return -1;
+            if (slot.index >= 0 && slot.tag == tag) {
+                const Entry& entry = entries_[slot.index];
+                if (entry.hash == hash && KeyEqual{}(entry.key, key)) return slot.index;
+            }
+        }
+    }
+
+    void place(size_t hash, int32_t index) {
+        size_t mask = slots_.size() - 1;
+        size_t i = hash & mask;
+        while (slots_[i].index != kEmpty) {
+            i = (i + 1) & mask;
+        }
+        slots_[i] = Slot{static_cast<uint32_t>(hash), index};
+    }
+
+    // перестраивает индекс под count записей, попутно выбрасывая удалённые
+    void rehash(size_t count) {
+        if (size_ != entries_.size()) {
+            std::vector<Entry> live;
+            live.reserve(size_);
+            for (auto& entry : entries_) {
+                if (entry.alive) live.push_back(std::move(entry));
+            }
+            entries_ = std::move(live);
+        }
+        size_t capacity = 8;
+        while (capacity * 3 < count * 4 + 4) {
+            capacity *= 2;
+        }
+        slots_.assign(capacity, Slot{0, kEmpty});
+        entries_.reserve(capacity * 3 / 4);
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            place(entries_[i].hash, static_cast<int32_t>(i));
+        }
+    }
+};
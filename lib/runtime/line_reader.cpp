@@ -0,0 +1,61 @@
+#include "line_reader.h"
+#include <algorithm>
+#include <cstring>
+
+thread_local std::shared_ptr<LineReader> g_input_reader;
+
+bool LineReader::refill() {
+    if (exhausted_) return false;
+    size_t tail = end_ - pos_;
+    size_t capacity = std::max(kChunkSize, tail * 2);
+    if (chunk_ && chunk_.use_count() == 1 && chunk_->size() >= capacity) {
+        // на блок не ссылается ни одна строка - хвост сдвигается в начало того же блока
+        std::memmove(chunk_->data(), chunk_->data() + pos_, tail);
+    } else {
+        // прежний блок остается жить в выданных строках, хвост копируется в новый
+        auto next = std::make_shared<std::string>(capacity, '\0');
+        if (tail) std::memcpy(next->data(), chunk_->data() + pos_, tail);
+        chunk_ = std::move(next);
+    }
+    pos_ = 0;
+    end_ = tail;
+    std::streamsize got = in_.rdbuf() ? in_.rdbuf()->sgetn(chunk_->data() + end_, chunk_->size() - end_) : 0;
+    if (got <= 0) {
+        exhausted_ = true;
+        return false;
+    }
+    end_ += static_cast<size_t>(got);
+    return true;
+}
+
+bool LineReader::next(Str& line) {
+    size_t scanned = pos_;
+    while (true) {
+        if (chunk_) {
+            const char* begin = chunk_->data();
+            auto newline = static_cast<const char*>(std::memchr(begin + scanned, '\n', end_ - scanned));
+            if (newline) {
+                size_t length = newline - (begin + pos_);
+                size_t next_pos = pos_ + length + 1;
+                if (length > 0 && begin[pos_ + length - 1] == '\r') --length;
+                line = Str(chunk_, pos_, length);
+                pos_ = next_pos;
+                return true;
+            }
+        }
+        size_t offset = end_ - pos_; // уже просмотренная часть хвоста не сканируется повторно
+        if (!refill()) break;
+        scanned = offset;
+    }
+    if (pos_ == end_) return false;
+    // последняя строка без \n
+    size_t length = end_ - pos_;
+    if (chunk_->data()[end_ - 1] == '\r') --length;
+    line = Str(chunk_, pos_, length);
+    pos_ = end_;
+    return true;
+}
+
+bool LineReader::eof() {
+    return pos_ == end_ && !refill();
+}
@@ -0,0 +1,47 @@
+// буферизованное построчное чтение входного потока
+#pragma once
+#include "types.h"
+#include <istream>
+#include <memory>
+#include <string>
+
+// поток читается крупными блоками; строка - срез блока без копирования (Str держит блок живым),
+// а незаконченная строка в конце блока переносится в начало следующего
+class LineReader {
+public:
+    explicit LineReader(std::istream& in) : in_(in) {}
+
+    // следующая строка без завершающего \n (и \r перед ним); false в конце потока
+    bool next(Str& line);
+    // строк больше нет
+    bool eof();
+
+private:
+    static constexpr size_t kChunkSize = 1 << 20;
+
+    std::istream& in_;
+    std::shared_ptr<std::string> chunk_;
+    size_t pos_ = 0; // начало непрочитанной части блока
+    size_t end_ = 0; // конец заполненной части блока
+    bool exhausted_ = false;
+
+    bool refill(); // дочитывает поток в блок, сохраняя непрочитанный хвост; false, если данных не прибавилось
+};
+
+// ленивый обход строк: каждая строка читается только при запросе следующего элемента
+class LinesIterator : public IteratorValue {
+public:
+    explicit LinesIterator(std::shared_ptr<LineReader> reader) : reader_(std::move(reader)) {}
+
+    bool next(Value& out) override {
+        Str line;
+        if (!reader_->next(line)) return false;
+        out = std::move(line);
+        return true;
+    }
+
+private:
+    std::shared_ptr<LineReader> reader_;
+};
+
+extern thread_local std::shared_ptr<LineReader> g_input_reader; // поток данных запуска интерпретатора в этом потоке
@@ -0,0 +1,440 @@
+#include "numeric_kernels.h"
+#include <algorithm>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define DFS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using SumFn = double (*)(const double* data, size_t n);
+using ExtremumFn = double (*)(const double* data, size_t n);
+using DotFn = double (*)(const double* a, const double* b, size_t n);
+using CountFn = size_t (*)(const double* data, size_t n, double threshold);
+using ElementwiseFn = void (*)(ElementOp op, ElementOperand a, ElementOperand b, double* out, size_t n);
+
+double sum_scalar(const double* data, size_t n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += data[i];
+        s1 += data[i + 1];
+        s2 += data[i + 2];
+        s3 += data[i + 3];
+    }
+    for (; i < n; ++i) s0 += data[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+// минимум и максимум распространяют NaN: если он есть среди чисел, результат - первый NaN.
+// так ведут себя все реализации, скалярная и векторные
+double min_of(double a, double b) {
+    return a < b || a != a ? a : b;
+}
+
+double max_of(double a, double b) {
+    return a > b || a != a ? a : b;
+}
+
+const double* first_nan(const double* data, size_t n) {
+    return std::find_if(data, data + n, [](double x) { return x != x; });
+}
+
+double min_scalar(const double* data, size_t n) {
+    double result = data[0];
+    for (size_t i = 1; i < n; ++i) result = min_of(result, data[i]);
+    return result;
+}
+
+double max_scalar(const double* data, size_t n) {
+    double result = data[0];
+    for (size_t i = 1; i < n; ++i) result = max_of(result, data[i]);
+    return result;
+}
+
+double dot_scalar(const double* a, const double* b, size_t n) {
+    double s0 = 0, s1 = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+    }
+    for (; i < n; ++i) s0 += a[i] * b[i];
+    return s0 + s1;
+}
+
+size_t greater_scalar(const double* data, size_t n, double threshold) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += data[i] > threshold;
+    return count;
+}
+
+size_t less_scalar(const double* data, size_t n, double threshold) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) count += data[i] < threshold;
+    return count;
+}
+
+double apply_element(ElementOp op, double x, double y) {
+    switch (op) {
+        case ElementOp::Add: return x + y;
+        case ElementOp::Sub: return x - y;
+        case ElementOp::Mul: return x * y;
+        case ElementOp::Div: return x / y;
+        case ElementOp::Less: return x < y;
+        case ElementOp::LessEqual: return x <= y;
+        case ElementOp::Greater: return x > y;
+        case ElementOp::GreaterEqual: return x >= y;
+        case ElementOp::Equal: return x == y;
+        case ElementOp::NotEqual: return x != y;
+    }
+    return 0;
+}
+
+// выбор операции вынесен из цикла, чтобы тело каждого цикла было простым
+template <ElementOp Op>
+void elementwise_loop(ElementOperand a, ElementOperand b, double* out, size_t start, size_t n) {
+    for (size_t i = start; i < n; ++i) {
+        out[i] = apply_element(Op, a.scalar ? a.data[0] : a.data[i], b.scalar ? b.data[0] : b.data[i]);
+    }
+}
+
+void elementwise_scalar_from(ElementOp op, ElementOperand a, ElementOperand b, double* out, size_t start, size_t n) {
+    switch (op) {
+        case ElementOp::Add: elementwise_loop<ElementOp::Add>(a, b, out, start, n); break;
+        case ElementOp::Sub: elementwise_loop<ElementOp::Sub>(a, b, out, start, n); break;
+        case ElementOp::Mul: elementwise_loop<ElementOp::Mul>(a, b, out, start, n); break;
+        case ElementOp::Div: elementwise_loop<ElementOp::Div>(a, b, out, start, n); break;
+        case ElementOp::Less: elementwise_loop<ElementOp::Less>(a, b, out, start, n); break;
+        case ElementOp::LessEqual: elementwise_loop<ElementOp::LessEqual>(a, b, out, start, n); break;
+        case ElementOp::Greater: elementwise_loop<ElementOp::Greater>(a, b, out, start, n); break;
+        case ElementOp::GreaterEqual: elementwise_loop<ElementOp::GreaterEqual>(a, b, out, start, n); break;
+        case ElementOp::Equal: elementwise_loop<ElementOp::Equal>(a, b, out, start, n); break;
+        case ElementOp::NotEqual: elementwise_loop<ElementOp::NotEqual>(a, b, out, start, n); break;
+    }
+}
+
+void elementwise_scalar(ElementOp op, ElementOperand a, ElementOperand b, double* out, size_t n) {
+    elementwise_scalar_from(op, a, b, out, 0, n);
+}
+
+#ifdef DFS_X86_KERNELS
+// несколько независимых аккумуляторов скрывают задержку сложения
+
+__attribute__((target("sse2")))
+double sum_sse2(const double* data, size_t n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(data + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(data + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + sum_scalar(data + i, n - i);
+}
+
+__attribute__((target("avx2")))
+double sum_avx2(const double* data, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(data + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(data + i + 4));
+        acc2 = _mm256_add_pd(acc2, _mm256_loadu_pd(data + i + 8));
+        acc3 = _mm256_add_pd(acc3, _mm256_loadu_pd(data + i + 12));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sum_scalar(data + i, n - i);
+}
+
+__attribute__((target("sse2")))
+double min_sse2(const double* data, size_t n) {
+    if (n < 4) return min_scalar(data, n);
+    // minpd теряет NaN, поэтому NaN отмечаются отдельной маской
+    __m128d acc = _mm_loadu_pd(data);
+    __m128d nan = _mm_cmpunord_pd(acc, acc);
+    size_t i = 2;
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(data + i);
+        acc = _mm_min_pd(acc, x);
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(x, x));
+    }
+    if (_mm_movemask_pd(nan)) return *first_nan(data, n);
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double result = min_of(lanes[0], lanes[1]);
+    for (; i < n; ++i) result = min_of(result, data[i]);
+    return result;
+}
+
+__attribute__((target("avx2")))
+double min_avx2(const double* data, size_t n) {
+    if (n < 8) return min_scalar(data, n);
+    __m256d acc0 = _mm256_loadu_pd(data), acc1 = _mm256_loadu_pd(data + 4);
+    __m256d nan = _mm256_or_pd(_mm256_cmp_pd(acc0, acc0, _CMP_UNORD_Q), _mm256_cmp_pd(acc1, acc1, _CMP_UNORD_Q));
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        __m256d x0 = _mm256_loadu_pd(data + i), x1 = _mm256_loadu_pd(data + i + 4);
+        acc0 = _mm256_min_pd(acc0, x0);
+        acc1 = _mm256_min_pd(acc1, x1);
+        nan = _mm256_or_pd(nan, _mm256_or_pd(_mm256_cmp_pd(x0, x0, _CMP_UNORD_Q), _mm256_cmp_pd(x1, x1, _CMP_UNORD_Q)));
+    }
+    if (_mm256_movemask_pd(nan)) return *first_nan(data, n);
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_min_pd(acc0, acc1));
+    double result = min_of(min_of(lanes[0], lanes[1]), min_of(lanes[2], lanes[3]));
+    for (; i < n; ++i) result = min_of(result, data[i]);
+    return result;
+}
+
+__attribute__((target("sse2")))
+double max_sse2(const double* data, size_t n) {
+    if (n < 4) return max_scalar(data, n);
+    // maxpd теряет NaN, поэтому NaN отмечаются отдельной маской
+    __m128d acc = _mm_loadu_pd(data);
+    __m128d nan = _mm_cmpunord_pd(acc, acc);
+    size_t i = 2;
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(data + i);
+        acc = _mm_max_pd(acc, x);
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(x, x));
+    }
+    if (_mm_movemask_pd(nan)) return *first_nan(data, n);
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double result = max_of(lanes[0], lanes[1]);
+    for (; i < n; ++i) result = max_of(result, data[i]);
+    return result;
+}
+
+__attribute__((target("avx2")))
+double max_avx2(const double* data, size_t n) {
+    if (n < 8) return max_scalar(data, n);
+    __m256d acc0 = _mm256_loadu_pd(data), acc1 = _mm256_loadu_pd(data + 4);
+    __m256d nan = _mm256_or_pd(_mm256_cmp_pd(acc0, acc0, _CMP_UNORD_Q), _mm256_cmp_pd(acc1, acc1, _CMP_UNORD_Q));
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        __m256d x0 = _mm256_loadu_pd(data + i), x1 = _mm256_loadu_pd(data + i + 4);
+        acc0 = _mm256_max_pd(acc0, x0);
+        acc1 = _mm256_max_pd(acc1, x1);
+        nan = _mm256_or_pd(nan, _mm256_or_pd(_mm256_cmp_pd(x0, x0, _CMP_UNORD_Q), _mm256_cmp_pd(x1, x1, _CMP_UNORD_Q)));
+    }
+    if (_mm256_movemask_pd(nan)) return *first_nan(data, n);
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_max_pd(acc0, acc1));
+    double result = max_of(max_of(lanes[0], lanes[1]), max_of(lanes[2], lanes[3]));
+    for (; i < n; ++i) result = max_of(result, data[i]);
+    return result;
+}
+
+__attribute__((target("sse2")))
+double dot_sse2(const double* a, const double* b, size_t n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    return lanes[0] + lanes[1] + dot_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+double dot_avx2(const double* a, const double* b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dot_scalar(a + i, b + i, n - i);
+}
+
+// сравнение даёт маску из единиц, её знаковые биты собираются movemask и считаются popcount
+__attribute__((target("sse2")))
+size_t greater_sse2(const double* data, size_t n, double threshold) {
+    const __m128d limit = _mm_set1_pd(threshold);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        count += __builtin_popcount(_mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(data + i), limit)));
+    }
+    return count + greater_scalar(data + i, n - i, threshold);
+}
+
+__attribute__((target("avx2")))
+size_t greater_avx2(const double* data, size_t n, double threshold) {
+    const __m256d limit = _mm256_set1_pd(threshold);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        count += __builtin_popcount(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(data + i), limit, _CMP_GT_OQ)));
+    }
+    return count + greater_scalar(data + i, n - i, threshold);
+}
+
+__attribute__((target("sse2")))
+size_t less_sse2(const double* data, size_t n, double threshold) {
+    const __m128d limit = _mm_set1_pd(threshold);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        count += __builtin_popcount(_mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(data + i), limit)));
+    }
+    return count + less_scalar(data + i, n - i, threshold);
+}
+
+__attribute__((target("avx2")))
+size_t less_avx2(const double* data, size_t n, double threshold) {
+    const __m256d limit = _mm256_set1_pd(threshold);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        count += __builtin_popcount(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(data + i), limit, _CMP_LT_OQ)));
+    }
+    return count + less_scalar(data + i, n - i, threshold);
+}
+
+// число-операнд размножается в регистр один раз до цикла; маска сравнения
+// превращается в 1.0/0.0 через and с единицами
+template <ElementOp Op>
+__attribute__((target("avx2")))
+__m256d apply_element_avx2(__m256d x, __m256d y) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    switch (Op) {
+        case ElementOp::Add: return _mm256_add_pd(x, y);
+        case ElementOp::Sub: return _mm256_sub_pd(x, y);
+        case ElementOp::Mul: return _mm256_mul_pd(x, y);
+        case ElementOp::Div: return _mm256_div_pd(x, y);
+        case ElementOp::Less: return _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_LT_OQ), one);
+        case ElementOp::LessEqual: return _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_LE_OQ), one);
+        case ElementOp::Greater: return _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_GT_OQ), one);
+        case ElementOp::GreaterEqual: return _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_GE_OQ), one);
+        case ElementOp::Equal: return _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_EQ_OQ), one);
+        case ElementOp::NotEqual: return _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_NEQ_UQ), one);
+    }
+    return x;
+}
+
+template <ElementOp Op>
+__attribute__((target("avx2")))
+void elementwise_loop_avx2(ElementOperand a, ElementOperand b, double* out, size_t n) {
+    const __m256d a_scalar = _mm256_set1_pd(a.data[0]);
+    const __m256d b_scalar = _mm256_set1_pd(b.data[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = a.scalar ? a_scalar : _mm256_loadu_pd(a.data + i);
+        __m256d y = b.scalar ? b_scalar : _mm256_loadu_pd(b.data + i);
+        _mm256_storeu_pd(out + i, apply_element_avx2<Op>(x, y));
+    }
+    elementwise_scalar_from(Op, a, b, out, i, n);
+}
+
+__attribute__((target("avx2")))
+void elementwise_avx2(ElementOp op, ElementOperand a, ElementOperand b, double* out, size_t n) {
+    if (n == 0) return;
+    switch (op) {
+        case ElementOp::Add: elementwise_loop_avx2<ElementOp::Add>(a, b, out, n); break;
+        case ElementOp::Sub: elementwise_loop_avx2<ElementOp::Sub>(a, b, out, n); break;
+        case ElementOp::Mul: elementwise_loop_avx2<ElementOp::Mul>(a, b, out, n); break;
+        case ElementOp::Div: elementwise_loop_avx2<ElementOp::Div>(a, b, out, n); break;
+        case ElementOp::Less: elementwise_loop_avx2<ElementOp::Less>(a, b, out, n); break;
+        case ElementOp::LessEqual: elementwise_loop_avx2<ElementOp::LessEqual>(a, b, out, n); break;
+        case ElementOp::Greater: elementwise_loop_avx2<ElementOp::Greater>(a, b, out, n); break;
+        case ElementOp::GreaterEqual: elementwise_loop_avx2<ElementOp::GreaterEqual>(a, b, out, n); break;
+        case ElementOp::Equal: elementwise_loop_avx2<ElementOp::Equal>(a, b, out, n); break;
+        case ElementOp::NotEqual: elementwise_loop_avx2<ElementOp::NotEqual>(a, b, out, n); break;
+    }
+}
+#endif
+
+struct Kernels {
+    SumFn sum = sum_scalar;
+    ExtremumFn min = min_scalar;
+    ExtremumFn max = max_scalar;
+    DotFn dot = dot_scalar;
+    CountFn greater = greater_scalar;
+    CountFn less = less_scalar;
+    ElementwiseFn elementwise = elementwise_scalar;
+
+    Kernels() {
+#ifdef DFS_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            sum = sum_avx2;
+            min = min_avx2;
+            max = max_avx2;
+            dot = dot_avx2;
+            greater = greater_avx2;
+            less = less_avx2;
+            elementwise = elementwise_avx2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            sum = sum_sse2;
+            min = min_sse2;
+            max = max_sse2;
+            dot = dot_sse2;
+            greater = greater_sse2;
+            less = less_sse2;
+        }
+#endif
+    }
+};
+
+const Kernels& kernels() {
+    static const Kernels instance;
+    return instance;
+}
+
+} // namespace
+
+double sum_numbers(const double* data, size_t n) {
+    return kernels().sum(data, n);
+}
+
+double min_number(const double* data, size_t n) {
+    return kernels().min(data, n);
+}
+
+double max_number(const double* data, size_t n) {
+    return kernels().max(data, n);
+}
+
+// первая позиция значения экстремума (NaN ищется как NaN). экстремум - всегда один из
+// элементов, но позиция на всякий случай не выходит за пределы списка
+static size_t position_of(const double* data, size_t n, double value) {
+    const double* found = value != value ? first_nan(data, n) : std::find(data, data + n, value);
+    return std::min<size_t>(found - data, n - 1);
+}
+
+// сначала векторно находим значение экстремума, затем - его первую позицию
+size_t argmin_number(const double* data, size_t n) {
+    return position_of(data, n, kernels().min(data, n));
+}
+
+size_t argmax_number(const double* data, size_t n) {
+    return position_of(data, n, kernels().max(data, n));
+}
+
+double dot_numbers(const double* a, const double* b, size_t n) {
+    return kernels().dot(a, b, n);
+}
+
+size_t count_greater(const double* data, size_t n, double threshold) {
+    return kernels().greater(data, n, threshold);
+}
+
+size_t count_less(const double* data, size_t n, double threshold) {
+    return kernels().less(data, n, threshold);
+}
+
+void elementwise(ElementOp op, ElementOperand a, ElementOperand b, double* out, size_t n) {
+    kernels().elementwise(op, a, b, out, n);
+}
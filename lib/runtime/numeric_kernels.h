@@ -0,0 +1,27 @@
+// ядра свёрток над массивами чисел
+#pragma once
+#include <cstddef>
+
+// реализация (AVX2, SSE2 или скалярная) выбирается один раз при первом вызове
+// в зависимости от возможностей процессора; n > 0 для min/max/argmin/argmax
+
+double sum_numbers(const double* data, size_t n);
+double min_number(const double* data, size_t n);
+double max_number(const double* data, size_t n);
+size_t argmin_number(const double* data, size_t n); // индекс первого минимума
+size_t argmax_number(const double* data, size_t n); // индекс первого максимума
+double dot_numbers(const double* a, const double* b, size_t n);
+size_t count_greater(const double* data, size_t n, double threshold);
+size_t count_less(const double* data, size_t n, double threshold);
+
+// поэлементные операции массивов
+enum class ElementOp { Add, Sub, Mul, Div, Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual };
+
+// операнд поэлементной операции: n чисел подряд либо одно число, размноженное на все позиции
+struct ElementOperand {
+    const double* data;
+    bool scalar;
+};
+
+// out[i] = a[i] op b[i]; сравнения дают 1 или 0; out может совпадать с буфером любого операнда
+void elementwise(ElementOp op, ElementOperand a, ElementOperand b, double* out, size_t n);
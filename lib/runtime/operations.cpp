@@ -1,9 +1,121 @@
 #include "operations.h"
 #include "utils.h"
+#include "string_kernels.h"
+#include "numeric_kernels.h"
 #include <cmath>
+#include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 
+// остаток от деления: для целых операндов - быстрый путь через целочисленное деление
+// вместо fmod (результат тот же: значение со знаком делимого)
+static double number_mod(double l, double r) {
+    int64_t a, b;
+    if (exact_int64(l, a) && exact_int64(r, b) && b != -1) { // INT64_MIN % -1 переполняется
+        int64_t rest = a % b;
+        return rest == 0 && l < 0 ? -0.0 : static_cast<double>(rest);
+    }
+    return std::fmod(l, r);
+}
+
+// степень: быстрый путь для целого основания в целой степени до 64 - возведение в квадрат
+// в целых числах, пока модуль результата не больше 2^53 и точно представим в double.
+// больший результат вычисляет std::pow с обычным округлением double
+static double number_pow(double base, double exponent) {
+    constexpr uint64_t kMaxExact = uint64_t(1) << 53;
+    int64_t b, e;
+    if (exact_int64(base, b) && exact_int64(exponent, e) && e >= 0 && e < 64) {
+        bool negative = b < 0 && (e & 1);
+        uint64_t factor = b < 0 ? 0 - static_cast<uint64_t>(b) : static_cast<uint64_t>(b);
+        uint64_t result = 1;
+        bool overflow = false;
+        while (!overflow) {
+            if (e & 1) {
+                overflow = factor != 0 && result > kMaxExact / factor;
+                result *= factor;
+            }
+            e >>= 1;
+            if (e == 0) break;
+            overflow = overflow || (factor != 0 && factor > kMaxExact / factor);
+            factor *= factor;
+        }
+        if (!overflow) return negative ? -static_cast<double>(result) : static_cast<double>(result);
+    }
+    return std::pow(base, exponent);
+}
+
+// поэлементная операция, в которой хотя бы один операнд - массив, а второй - массив или число;
+// reuse_left/reuse_right разрешают записать результат в буфер соответствующего операнда
+// число повторений unit-элементов, при котором результат перерастает адресуемую память
+static bool repeat_overflows(size_t unit, int64_t times) {
+    return unit != 0 && static_cast<uint64_t>(times) > PTRDIFF_MAX / unit;
+}
+
+static Value apply_array_op(const Value& left, const Value& right, TokenType op, bool reuse_left, bool reuse_right) {
+    bool left_array = std::holds_alternative<Array>(left);
+    bool right_array = std::holds_alternative<Array>(right);
+    if ((!left_array && !std::holds_alternative<double>(left)) || (!right_array && !std::holds_alternative<double>(right))) {
+        throw std::runtime_error("Недопустимые операнды для бинарного оператора");
+    }
+    ElementOperand a = left_array ? ElementOperand{std::get<Array>(left)->data.data(), false} : ElementOperand{&std::get<double>(left), true};
+    ElementOperand b = right_array ? ElementOperand{std::get<Array>(right)->data.data(), false} : ElementOperand{&std::get<double>(right), true};
+    size_t n = left_array ? std::get<Array>(left)->data.size() : std::get<Array>(right)->data.size();
+    if (left_array && right_array && std::get<Array>(right)->data.size() != n) {
+        throw std::runtime_error("Массивы должны быть одинаковой длины");
+    }
+
+    Array result;
+    if (left_array && reuse_left) {
+        result = std::get<Array>(left);
+    } else if (right_array && reuse_right) {
+        result = std::get<Array>(right);
+    } else {
+        result = std::make_shared<ArrayValue>();
+        result->data.resize(n);
+    }
+    double* out = result->data.data();
+
+    switch (op) {
+        case TokenType::PLUS: elementwise(ElementOp::Add, a, b, out, n); break;
+        case TokenType::MINUS: elementwise(ElementOp::Sub, a, b, out, n); break;
+        case TokenType::MULTIPLY: elementwise(ElementOp::Mul, a, b, out, n); break;
+        case TokenType::DIVIDE:
+            if (std::find(b.data, b.data + (b.scalar ? 1 : n), 0.0) != b.data + (b.scalar ? 1 : n)) throw std::runtime_error("Деление на ноль");
+            elementwise(ElementOp::Div, a, b, out, n);
+            break;
+        case TokenType::MODULO:
+            if (std::find(b.data, b.data + (b.scalar ? 1 : n), 0.0) != b.data + (b.scalar ? 1 : n)) throw std::runtime_error("Модуль по нулю");
+            for (size_t i = 0; i < n; ++i) out[i] = number_mod(a.scalar ? a.data[0] : a.data[i], b.scalar ? b.data[0] : b.data[i]);
+            break;
+        case TokenType::POWER:
+            for (size_t i = 0; i < n; ++i) out[i] = number_pow(a.scalar ? a.data[0] : a.data[i], b.scalar ? b.data[0] : b.data[i]);
+            break;
+        case TokenType::LESS: elementwise(ElementOp::Less, a, b, out, n); break;
+        case TokenType::LESS_EQUAL: elementwise(ElementOp::LessEqual, a, b, out, n); break;
+        case TokenType::GREATER: elementwise(ElementOp::Greater, a, b, out, n); break;
+        case TokenType::GREATER_EQUAL: elementwise(ElementOp::GreaterEqual, a, b, out, n); break;
+        case TokenType::EQUAL_EQUAL: elementwise(ElementOp::Equal, a, b, out, n); break;
+        case TokenType::NOT_EQUAL: elementwise(ElementOp::NotEqual, a, b, out, n); break;
+        default: throw std::runtime_error("Недопустимые операнды для бинарного оператора");
+    }
+    return result;
+}
+
+Value apply_binary_op(Value&& left, Value&& right, TokenType op) {
+    bool reuse_left = std::holds_alternative<Array>(left) && std::get<Array>(left).use_count() == 1;
+    bool reuse_right = std::holds_alternative<Array>(right) && std::get<Array>(right).use_count() == 1;
+    bool numeric = (std::holds_alternative<Array>(left) || std::holds_alternative<double>(left)) &&
+                   (std::holds_alternative<Array>(right) || std::holds_alternative<double>(right));
+    if ((reuse_left || reuse_right) && numeric && op != TokenType::IN) {
+        return apply_array_op(left, right, op, reuse_left, reuse_right);
+    }
+    return apply_binary_op(static_cast<const Value&>(left), static_cast<const Value&>(right), op);
+}
+
 Value apply_binary_op(const Value& left, const Value& right, TokenType op) {
+    if (op == TokenType::IN) {
+        return static_cast<double>(contains_value(right, left));
+    }
     if (std::holds_alternative<NullType>(left) || std::holds_alternative<NullType>(right)) {
         if (op == TokenType::EQUAL_EQUAL) {
             return static_cast<double>(std::holds_alternative<NullType>(left) && std::holds_alternative<NullType>(right));
@@ -12,50 +124,68 @@ Value apply_binary_op(const Value& left, const Value& right, TokenType op) {
         }
         throw std::runtime_error("Недопустимые операнды для бинарного оператора");
     }
+    if (std::holds_alternative<Array>(left) || std::holds_alternative<Array>(right)) {
+        return apply_array_op(left, right, op, false, false);
+    }
     if (std::holds_alternative<List>(left)) {
         const List& list_left = std::get<List>(left);
         if (op == TokenType::PLUS && std::holds_alternative<List>(right)) {
             const List& list_right = std::get<List>(right);
-            auto result = std::make_shared<ListValue>();
-            result->elements = list_left->elements;
-            result->elements.insert(result->elements.end(), list_right->elements.begin(), list_right->elements.end());
+            auto result = make_ref<ListValue>();
+            result->reserve(list_left->size() + list_right->size());
+            result->append(*list_left);
+            result->append(*list_right);
             return result;
         } else if (op == TokenType::MULTIPLY && std::holds_alternative<double>(right)) {
             double count = std::get<double>(right);
-            if (count <= 0) return std::make_shared<ListValue>();
-            auto result = std::make_shared<ListValue>();
-            int full_repeats = static_cast<int>(count);
-            for (int i = 0; i < full_repeats; ++i) {
-                result->elements.insert(result->elements.end(), list_left->elements.begin(), list_left->elements.end());
+            if (!(count > 0) || list_left->size() == 0) return make_ref<ListValue>();
+            int64_t full_repeats = to_index(count);
+            if (repeat_overflows(list_left->size() * sizeof(Value), full_repeats)) {
+                throw std::runtime_error("Слишком длинный список");
+            }
+            auto result = make_ref<ListValue>();
+            result->reserve(list_left->size() * full_repeats);
+            for (int64_t i = 0; i < full_repeats; ++i) {
+                result->append(*list_left);
             }
             return result;
         }
     }
-    if (std::holds_alternative<std::string>(left)) {
-        const std::string& str_left = std::get<std::string>(left);
+    if (std::holds_alternative<Str>(left)) {
+        const Str& str_left = std::get<Str>(left);
         if (op == TokenType::PLUS) {
-            if (std::holds_alternative<std::string>(right)) return str_left + std::get<std::string>(right);
-            if (std::holds_alternative<double>(right)) return str_left + format_number(std::get<double>(right));
-        } else if (op == TokenType::MINUS && std::holds_alternative<std::string>(right)) {
-            const std::string& str_right = std::get<std::string>(right);
-            if (str_left.size() >= str_right.size() && str_left.substr(str_left.size() - str_right.size()) == str_right) {
+            if (std::holds_alternative<Str>(right)) {
+                const Str& str_right = std::get<Str>(right);
+                if (str_right.empty()) return str_left;
+                std::string result;
+                result.reserve(str_left.size() + str_right.size());
+                result += str_left.view();
+                result += str_right.view();
+                return result;
+            }
+            if (std::holds_alternative<double>(right)) return str_left.str() + format_number(std::get<double>(right));
+        } else if (op == TokenType::MINUS && std::holds_alternative<Str>(right)) {
+            std::string_view str_right = std::get<Str>(right).view();
+            if (str_left.view().ends_with(str_right)) {
                 return str_left.substr(0, str_left.size() - str_right.size());
             }
             return str_left;
         } else if (op == TokenType::MULTIPLY && std::holds_alternative<double>(right)) {
             double count = std::get<double>(right);
-            if (count <= 0) return std::string();
+            if (!(count > 0) || str_left.empty()) return Str();
+            int64_t full_repeats = to_index(count);
+            if (repeat_overflows(str_left.size(), full_repeats)) throw std::runtime_error("Слишком длинная строка");
             std::string result;
-            int full_repeats = static_cast<int>(count);
-            for (int i = 0; i < full_repeats; ++i) result += str_left;
+            result.reserve(str_left.size() * (full_repeats + 1));
+            for (int64_t i = 0; i < full_repeats; ++i) result += str_left.view();
             double fraction = count - full_repeats;
             if (fraction > 0) {
                 int chars_to_add = static_cast<int>(str_left.size() * fraction);
-                result += str_left.substr(0, chars_to_add);
+                result += str_left.view().substr(0, chars_to_add);
             }
             return result;
-        } else if (std::holds_alternative<std::string>(right)) {
-            const std::string& str_right = std::get<std::string>(right);
+        } else if (std::holds_alternative<Str>(right)) {
+            const Str& str_right = std::get<Str>(right);
             switch (op) {
                 case TokenType::EQUAL_EQUAL: return static_cast<double>(str_left == str_right);
                 case TokenType::NOT_EQUAL: return static_cast<double>(str_left != str_right);
@@ -79,8 +209,8 @@ Value apply_binary_op(const Value& left, const Value& right, TokenType op) {
                 return l / r;
             case TokenType::MODULO:
                 if (r == 0) throw std::runtime_error("Модуль по нулю");
-                return std::fmod(l, r);
-            case TokenType::POWER: return std::pow(l, r);
+                return number_mod(l, r);
+            case TokenType::POWER: return number_pow(l, r);
             case TokenType::EQUAL_EQUAL: return static_cast<double>(l == r);
             case TokenType::NOT_EQUAL: return static_cast<double>(l != r);
             case TokenType::LESS: return static_cast<double>(l < r);
@@ -95,7 +225,106 @@ Value apply_binary_op(const Value& left, const Value& right, TokenType op) {
     throw std::runtime_error("Недопустимые операнды для бинарного оператора");
 }
 
+// специализация для операндов, которые узел увидел при первом выполнении
+static BinaryKind specialize_binary_op(const Value& left, const Value& right, TokenType op) {
+    if (std::holds_alternative<double>(left) && std::holds_alternative<double>(right)) {
+        switch (op) {
+            case TokenType::PLUS: return BinaryKind::NumberAdd;
+            case TokenType::MINUS: return BinaryKind::NumberSub;
+            case TokenType::MULTIPLY: return BinaryKind::NumberMul;
+            case TokenType::DIVIDE: return BinaryKind::NumberDiv;
+            case TokenType::MODULO: return BinaryKind::NumberMod;
+            case TokenType::POWER: return BinaryKind::NumberPow;
+            case TokenType::EQUAL_EQUAL: return BinaryKind::NumberEqual;
+            case TokenType::NOT_EQUAL: return BinaryKind::NumberNotEqual;
+            case TokenType::LESS: return BinaryKind::NumberLess;
+            case TokenType::LESS_EQUAL: return BinaryKind::NumberLessEqual;
+            case TokenType::GREATER: return BinaryKind::NumberGreater;
+            case TokenType::GREATER_EQUAL: return BinaryKind::NumberGreaterEqual;
+            case TokenType::AND: return BinaryKind::NumberAnd;
+            case TokenType::OR: return BinaryKind::NumberOr;
+            default: return BinaryKind::Generic;
+        }
+    }
+    if (std::holds_alternative<Str>(left) && std::holds_alternative<Str>(right)) {
+        switch (op) {
+            case TokenType::PLUS: return BinaryKind::StringConcat;
+            case TokenType::EQUAL_EQUAL: return BinaryKind::StringEqual;
+            case TokenType::NOT_EQUAL: return BinaryKind::StringNotEqual;
+            case TokenType::LESS: return BinaryKind::StringLess;
+            case TokenType::LESS_EQUAL: return BinaryKind::StringLessEqual;
+            case TokenType::GREATER: return BinaryKind::StringGreater;
+            case TokenType::GREATER_EQUAL: return BinaryKind::StringGreaterEqual;
+            default: return BinaryKind::Generic;
+        }
+    }
+    return BinaryKind::Generic;
+}
+
+Value apply_binary_op(BinaryKind& kind, Value&& left, Value&& right, TokenType op) {
+    if (kind >= BinaryKind::NumberAdd && kind <= BinaryKind::NumberOr) {
+        const double* l = std::get_if<double>(&left);
+        const double* r = std::get_if<double>(&right);
+        if (l && r) {
+            switch (kind) {
+                case BinaryKind::NumberAdd: return *l + *r;
+                case BinaryKind::NumberSub: return *l - *r;
+                case BinaryKind::NumberMul: return *l * *r;
+                case BinaryKind::NumberDiv:
+                    if (*r == 0) throw std::runtime_error("Деление на ноль");
+                    return *l / *r;
+                case BinaryKind::NumberMod:
+                    if (*r == 0) throw std::runtime_error("Модуль по нулю");
+                    return number_mod(*l, *r);
+                case BinaryKind::NumberPow: return number_pow(*l, *r);
+                case BinaryKind::NumberEqual: return static_cast<double>(*l == *r);
+                case BinaryKind::NumberNotEqual: return static_cast<double>(*l != *r);
+                case BinaryKind::NumberLess: return static_cast<double>(*l < *r);
+                case BinaryKind::NumberLessEqual: return static_cast<double>(*l <= *r);
+                case BinaryKind::NumberGreater: return static_cast<double>(*l > *r);
+                case BinaryKind::NumberGreaterEqual: return static_cast<double>(*l >= *r);
+                case BinaryKind::NumberAnd: return static_cast<double>((*l != 0) && (*r != 0));
+                case BinaryKind::NumberOr: return static_cast<double>((*l != 0) || (*r != 0));
+                default: break;
+            }
+        }
+        kind = BinaryKind::Generic;
+    } else if (kind >= BinaryKind::StringConcat) {
+        const Str* l = std::get_if<Str>(&left);
+        const Str* r = std::get_if<Str>(&right);
+        if (l && r) {
+            switch (kind) {
+                case BinaryKind::StringConcat: {
+                    if (r->empty()) return std::move(left);
+                    std::string result;
+                    result.reserve(l->size() + r->size());
+                    result += l->view();
+                    result += r->view();
+                    return result;
+                }
+                case BinaryKind::StringEqual: return static_cast<double>(*l == *r);
+                case BinaryKind::StringNotEqual: return static_cast<double>(*l != *r);
+                case BinaryKind::StringLess: return static_cast<double>(*l < *r);
+                case BinaryKind::StringLessEqual: return static_cast<double>(*l <= *r);
+                case BinaryKind::StringGreater: return static_cast<double>(*l > *r);
+                case BinaryKind::StringGreaterEqual: return static_cast<double>(*l >= *r);
+                default: break;
+            }
+        }
+        kind = BinaryKind::Generic;
+    } else if (kind == BinaryKind::Unobserved) {
+        kind = specialize_binary_op(left, right, op);
+    }
+    return apply_binary_op(std::move(left), std::move(right), op);
+}
+
 Value apply_unary_op(TokenType op, const Value& operand) {
+    if (std::holds_alternative<Array>(operand)) {
+        if (op == TokenType::PLUS) return operand;
+        if (op == TokenType::MINUS) return apply_array_op(0.0, operand, TokenType::MINUS, false, false);
+        if (op == TokenType::NOT) return apply_array_op(operand, 0.0, TokenType::EQUAL_EQUAL, false, false);
+        throw std::runtime_error("Неизвестный унарный оператор");
+    }
     if (!std::holds_alternative<double>(operand)) {
         throw std::runtime_error("Унарные операторы могут применяться только к числам");
     }
@@ -118,4 +347,33 @@ TokenType get_binary_op_from_compound_assign(TokenType op) {
         case TokenType::POWER_EQUALS: return TokenType::POWER;
         default: throw std::runtime_error("Недопустимый оператор составного присваивания");
     }
+}
+
+bool contains_value(const Value& container, const Value& item) { // проверка принадлежности для оператора in
+    if (std::holds_alternative<Set>(container)) {
+        return is_hashable(item) && std::get<Set>(container)->table.contains(item);
+    }
+    if (std::holds_alternative<Map>(container)) {
+        return is_hashable(item) && std::get<Map>(container)->table.contains(item);
+    }
+    if (std::holds_alternative<List>(container)) {
+        const List& list = std::get<List>(container);
+        if (list->packed()) {
+            if (!std::holds_alternative<double>(item)) return false;
+            return std::find(list->numbers(), list->numbers() + list->size(), std::get<double>(item)) != list->numbers() + list->size();
+        }
+        for (size_t i = 0; i < list->size(); ++i) {
+            if (list->get(i) == item) return true;
+        }
+        return false;
+    }
+    if (std::holds_alternative<Array>(container)) {
+        if (!std::holds_alternative<double>(item)) return false;
+        const auto& data = std::get<Array>(container)->data;
+        return std::find(data.begin(), data.end(), std::get<double>(item)) != data.end();
+    }
+    if (std::holds_alternative<Str>(container) && std::holds_alternative<Str>(item)) {
+        return find_substring(std::get<Str>(container).view(), std::get<Str>(item).view()) != std::string_view::npos;
+    }
+    throw std::runtime_error("Оператор in требует строку, список, массив, словарь или множество");
 }
\ No newline at end of file
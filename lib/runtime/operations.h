@@ -1,7 +1,15 @@
 #pragma once
 #include "types.h"
 #include "lexer/lexer.h"
+#include "parser/ast.h"
 
 Value apply_binary_op(const Value& left, const Value& right, TokenType op);
+// операнды-временные значения: массив, которым больше никто не владеет, переиспользуется под результат
+Value apply_binary_op(Value&& left, Value&& right, TokenType op);
+// операция узла со специализацией kind: при совпадении типов операндов выполняется только
+// специализированная ветвь; первый вызов выбирает специализацию, несовпадение типов
+// навсегда переводит узел на общий путь
+Value apply_binary_op(BinaryKind& kind, Value&& left, Value&& right, TokenType op);
 Value apply_unary_op(TokenType op, const Value& operand);
-TokenType get_binary_op_from_compound_assign(TokenType op);
\ No newline at end of file
+TokenType get_binary_op_from_compound_assign(TokenType op);
+bool contains_value(const Value& container, const Value& item);
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "pool.h"
+#include "gc.h"
+#include <mutex>
+
+thread_local HeapPool* g_current_pool = nullptr;
+
+namespace {
+
+// пул для объектов, созданных вне выполнения скрипта; не удаляется, потому что его блоки
+// могут освобождаться вплоть до завершения процесса
+std::mutex g_shared_mutex;
+
+HeapPool& shared_pool() {
+    static HeapPool* pool = new HeapPool;
+    return *pool;
+}
+
+} // namespace
+
+HeapPool::~HeapPool() {
+    // оставшиеся объекты пула - недостижимые циклы, которые собирает сборщик, или замороженные
+    // значения: сборщик их не учитывает, а живы они могут быть и в других потоках. если блоки
+    // все равно остались, участки не освобождаются, а переходят общему пулу вместе с ними
+    if (live_ != 0) collect_cycles();
+    std::lock_guard lock(g_shared_mutex);
+    take_remote();
+    if (live_ != 0) {
+        hand_over(shared_pool());
+        return;
+    }
+    for (void* slab : slabs_) ::operator delete(slab, std::align_val_t(kSlabSize));
+}
+
+void* HeapPool::carve(size_t index) {
+    if (has_remote_.load(std::memory_order_acquire)) {
+        {
+            std::lock_guard lock(g_shared_mutex);
+            take_remote();
+        }
+        if (FreeBlock* block = free_[index]) {
+            free_[index] = block->next;
+            return block;
+        }
+    }
+    size_t size = (index + 1) * kGranularity;
+    if (static_cast<size_t>(end_[index] - cursor_[index]) < size) {
+        char* slab = static_cast<char*>(::operator new(kSlabSize, std::align_val_t(kSlabSize)));
+        new (slab) SlabHeader{this};
+        slabs_.push_back(slab);
+        cursor_[index] = slab + sizeof(SlabHeader);
+        end_[index] = slab + kSlabSize;
+    }
+    void* block = cursor_[index];
+    cursor_[index] += size;
+    return block;
+}
+
+// вызывается под мьютексом общего пула
+void HeapPool::take_remote() {
+    for (RemoteBlock* block = remote_; block != nullptr;) {
+        RemoteBlock* next = block->next;
+        size_t index = block->index;
+        --live_;
+        free_[index] = new (block) FreeBlock{free_[index]};
+        block = next;
+    }
+    remote_ = nullptr;
+    has_remote_.store(false, std::memory_order_relaxed);
+}
+
+// участки, свободные блоки и счет живых блоков переходят heir; вызывается под мьютексом общего пула
+void HeapPool::hand_over(HeapPool& heir) {
+    for (void* slab : slabs_) {
+        static_cast<SlabHeader*>(slab)->owner.store(&heir, std::memory_order_relaxed);
+        heir.slabs_.push_back(slab);
+    }
+    for (size_t index = 0; index < kClasses; ++index) {
+        while (FreeBlock* block = free_[index]) {
+            free_[index] = block->next;
+            heir.free_[index] = new (block) FreeBlock{heir.free_[index]};
+        }
+    }
+    heir.live_ += live_;
+    live_ = 0;
+    slabs_.clear();
+}
+
+HeapPool::Scope::Scope(HeapPool& pool) : previous_(g_current_pool) {
+    g_current_pool = &pool;
+}
+
+HeapPool::Scope::~Scope() {
+    g_current_pool = previous_;
+}
+
+void* shared_pool_allocate(size_t size) {
+    std::lock_guard lock(g_shared_mutex);
+    return shared_pool().allocate(size);
+}
+
+void foreign_pool_deallocate(void* block, size_t size) {
+    // владелец читается под мьютексом: так участок не может перейти общему пулу между
+    // чтением и постановкой блока в очередь удаляемого пула
+    std::lock_guard lock(g_shared_mutex);
+    HeapPool* owner = HeapPool::owner_of(block);
+    if (owner == &shared_pool()) {
+        owner->deallocate(block, size);
+    } else {
+        owner->remote_ = new (block) HeapPool::RemoteBlock{owner->remote_, HeapPool::class_of(size)};
+        owner->has_remote_.store(true, std::memory_order_release);
+    }
+}
@@ -0,0 +1,132 @@
+// выделение памяти небольшим объектам кучи интерпретатора
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// пул блоков по классам размеров (кратным 16 байтам, до kMaxBlockSize): блоки нарезаются
+// из крупных участков (slab), а освобожденный блок попадает в список свободных своего класса.
+// у каждого интерпретатора свой пул; участки возвращаются системе целиком при его удалении.
+// выделяет и освобождает напрямую только поток владельца; блоки, освобожденные в других потоках
+// (замороженные значения), копятся в очереди под мьютексом и разбираются владельцем при нехватке.
+// если при удалении пула его блоки еще живы, участки переходят общему пулу
+class HeapPool {
+public:
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxBlockSize = 512; // большие блоки выделяет operator new
+    static constexpr size_t kSlabSize = 64 * 1024;
+
+    HeapPool() = default;
+    ~HeapPool();
+    HeapPool(const HeapPool&) = delete;
+    HeapPool& operator=(const HeapPool&) = delete;
+
+    void* allocate(size_t size) {
+        size_t index = class_of(size);
+        ++live_;
+        if (FreeBlock* block = free_[index]) {
+            free_[index] = block->next;
+            return block;
+        }
+        return carve(index);
+    }
+    void deallocate(void* block, size_t size) {
+        size_t index = class_of(size);
+        --live_;
+        free_[index] = new (block) FreeBlock{free_[index]};
+    }
+
+    // пул, которому принадлежит блок: заголовок участка лежит по адресу, выровненному на kSlabSize
+    static HeapPool* owner_of(const void* block) {
+        auto slab = reinterpret_cast<std::uintptr_t>(block) & ~(std::uintptr_t(kSlabSize) - 1);
+        return reinterpret_cast<const SlabHeader*>(slab)->owner.load(std::memory_order_relaxed);
+    }
+
+    // пул, из которого выделяется память, пока объект жив (выполнение скрипта, ввод сеанса)
+    class Scope {
+    public:
+        explicit Scope(HeapPool& pool);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        HeapPool* previous_;
+    };
+
+private:
+    static constexpr size_t kClasses = kMaxBlockSize / kGranularity;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    struct RemoteBlock { // блок, освобожденный чужим потоком
+        RemoteBlock* next;
+        size_t index;
+    };
+    struct alignas(kGranularity) SlabHeader {
+        std::atomic<HeapPool*> owner; // меняется при передаче участков общему пулу
+    };
+
+    static size_t class_of(size_t size) { return size == 0 ? 0 : (size - 1) / kGranularity; }
+    void* carve(size_t index); // блок из очереди чужих, из текущего участка класса или из нового участка
+    void take_remote();        // переносит очередь чужих блоков в списки свободных
+    void hand_over(HeapPool& heir);
+
+    friend void foreign_pool_deallocate(void* block, size_t size);
+
+    FreeBlock* free_[kClasses] = {};
+    char* cursor_[kClasses] = {};
+    char* end_[kClasses] = {};
+    std::vector<void*> slabs_;
+    size_t live_ = 0; // выделенных и еще не освобожденных блоков
+    RemoteBlock* remote_ = nullptr;        // под мьютексом общего пула
+    std::atomic<bool> has_remote_ = false; // очередь не пуста: проверка без захвата мьютекса
+};
+
+extern thread_local HeapPool* g_current_pool;
+
+void* shared_pool_allocate(size_t size);
+void foreign_pool_deallocate(void* block, size_t size); // блок чужого или общего пула
+
+// блок из пула текущего интерпретатора; вне выполнения - из общего пула под мьютексом
+inline void* pool_allocate(size_t size) {
+    if (size > HeapPool::kMaxBlockSize) return ::operator new(size);
+    if (HeapPool* pool = g_current_pool) return pool->allocate(size);
+    return shared_pool_allocate(size);
+}
+
+// размер должен совпадать с запрошенным при выделении; блок возвращается пулу, из которого выделен
+inline void pool_deallocate(void* block, size_t size) {
+    if (size > HeapPool::kMaxBlockSize) {
+        ::operator delete(block);
+        return;
+    }
+    HeapPool* owner = HeapPool::owner_of(block);
+    if (owner == g_current_pool) {
+        owner->deallocate(block, size);
+    } else {
+        foreign_pool_deallocate(block, size);
+    }
+}
+
+// распределитель для контейнеров значений (элементы списков)
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(pool_allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { pool_deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const { return true; }
+};
+
+template <typename T>
+using PooledVector = std::vector<T, PoolAllocator<T>>;
@@ -0,0 +1,102 @@
+// владение значениями кучи со счетчиком ссылок внутри самого объекта
+#pragma once
+#include "pool.h"
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// основа объекта, которым владеет Ref. экземпляр интерпретатора однопоточный, поэтому
+// счетчик обычный; замороженный объект (freeze) может разделяться между потоками
+// и считает ссылки атомарно
+class RefCounted {
+public:
+    RefCounted() = default;
+    // копия объекта - новый объект со своим счетчиком
+    RefCounted(const RefCounted&) {}
+    RefCounted& operator=(const RefCounted&) { return *this; }
+
+    bool frozen() const { return frozen_; }
+
+    // объекты размещаются в пуле интерпретатора (pool.h)
+    static void* operator new(size_t size) { return pool_allocate(size); }
+    static void operator delete(void* block, size_t size) { pool_deallocate(block, size); }
+
+protected:
+    // переключение на атомарный счетчик: вызывается до того, как объект увидят другие потоки
+    void mark_frozen() { frozen_ = true; }
+
+    // счетчик меняют Ref и сборщик циклов (gc.h)
+    template <typename T>
+    friend class Ref;
+
+    void retain() const noexcept {
+        if (frozen_) {
+            std::atomic_ref<size_t>(refs_).fetch_add(1, std::memory_order_relaxed);
+        } else {
+            ++refs_;
+        }
+    }
+    // true, если освобождена последняя ссылка
+    bool release() const noexcept {
+        if (frozen_) return std::atomic_ref<size_t>(refs_).fetch_sub(1, std::memory_order_acq_rel) == 1;
+        return --refs_ == 0;
+    }
+    size_t use_count() const noexcept {
+        if (frozen_) return std::atomic_ref<size_t>(refs_).load(std::memory_order_relaxed);
+        return refs_;
+    }
+
+private:
+    alignas(std::atomic_ref<size_t>::required_alignment) mutable size_t refs_ = 0;
+    bool frozen_ = false;
+};
+
+// указатель-владелец на наследника RefCounted: как std::shared_ptr, но без отдельного
+// блока управления и без атомарных операций для незамороженных объектов
+template <typename T>
+class Ref {
+public:
+    Ref() = default;
+    Ref(std::nullptr_t) {}
+    // принимает объект, созданный new (см. make_ref)
+    explicit Ref(T* ptr) : ptr_(ptr) {
+        if (ptr_) ptr_->retain();
+    }
+    Ref(const Ref& other) : ptr_(other.ptr_) {
+        if (ptr_) ptr_->retain();
+    }
+    Ref(Ref&& other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {}
+    ~Ref() { reset(); }
+
+    Ref& operator=(const Ref& other) {
+        Ref(other).swap(*this);
+        return *this;
+    }
+    Ref& operator=(Ref&& other) noexcept {
+        Ref(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void reset() {
+        if (ptr_ && ptr_->release()) delete ptr_;
+        ptr_ = nullptr;
+    }
+    void swap(Ref& other) noexcept { std::swap(ptr_, other.ptr_); }
+
+    T* get() const { return ptr_; }
+    T& operator*() const { return *ptr_; }
+    T* operator->() const { return ptr_; }
+    explicit operator bool() const { return ptr_ != nullptr; }
+    size_t use_count() const { return ptr_ ? ptr_->use_count() : 0; }
+
+    friend bool operator==(const Ref& a, const Ref& b) { return a.ptr_ == b.ptr_; }
+    friend bool operator==(const Ref& a, std::nullptr_t) { return a.ptr_ == nullptr; }
+
+private:
+    T* ptr_ = nullptr;
+};
+
+template <typename T, typename... Args>
+Ref<T> make_ref(Args&&... args) {
+    return Ref<T>(new T(std::forward<Args>(args)...));
+}
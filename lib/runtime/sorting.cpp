@@ -0,0 +1,117 @@
+#include "sorting.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kRadixThreshold = 256;        // ниже - std::sort быстрее поразрядной
+constexpr size_t kParallelThreshold = 1 << 20; // ниже - потоки не окупаются
+
+// отображение double в uint64 с сохранением порядка: у неотрицательных
+// взводится знаковый бит, у отрицательных инвертируются все биты
+uint64_t to_key(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+// порядок ключей to_key: NaN со знаковым битом - до всех чисел, остальные NaN - после, -0 < 0.
+// им сравнивают и короткие куски, и слияние, чтобы порядок не зависел от длины списка
+bool key_less(double a, double b) {
+    return to_key(a) < to_key(b);
+}
+
+double from_key(uint64_t key) {
+    uint64_t bits = (key >> 63) ? key & ~(uint64_t(1) << 63) : ~key;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// 8 проходов по байту; гистограммы всех проходов считаются за один обход,
+// а проходы, где у всех ключей одинаковый байт, пропускаются
+void radix_sort(double* data, size_t n) {
+    std::vector<uint64_t> keys(n), buffer(n);
+    size_t counts[8][256] = {};
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t key = to_key(data[i]);
+        keys[i] = key;
+        for (int pass = 0; pass < 8; ++pass) ++counts[pass][(key >> (pass * 8)) & 0xff];
+    }
+    uint64_t* from = keys.data();
+    uint64_t* to = buffer.data();
+    for (int pass = 0; pass < 8; ++pass) {
+        size_t* count = counts[pass];
+        if (count[(from[0] >> (pass * 8)) & 0xff] == n) continue;
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            size_t c = count[digit];
+            count[digit] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t key = from[i];
+            to[count[(key >> (pass * 8)) & 0xff]++] = key;
+        }
+        std::swap(from, to);
+    }
+    for (size_t i = 0; i < n; ++i) data[i] = from_key(from[i]);
+}
+
+void sort_chunk(double* data, size_t n) {
+    if (n < kRadixThreshold) {
+        std::sort(data, data + n, key_less);
+    } else {
+        radix_sort(data, n);
+    }
+}
+
+// куски сортируются параллельно, затем соседние пары сливаются параллельно
+// раунд за раундом с переключением между data и buffer
+void parallel_sort(double* data, size_t n, size_t threads) {
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= threads; ++i) bounds.push_back(n * i / threads);
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(sort_chunk, data + bounds[i], bounds[i + 1] - bounds[i]);
+    }
+    for (auto& worker : workers) worker.join();
+
+    std::vector<double> buffer(n);
+    double* from = data;
+    double* to = buffer.data();
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged;
+        workers.clear();
+        size_t i = 0;
+        for (; i + 2 < bounds.size(); i += 2) {
+            size_t lo = bounds[i], mid = bounds[i + 1], hi = bounds[i + 2];
+            workers.emplace_back([=] { std::merge(from + lo, from + mid, from + mid, from + hi, to + lo, key_less); });
+            merged.push_back(lo);
+        }
+        if (i + 1 < bounds.size()) { // непарный последний кусок переносится как есть
+            std::copy(from + bounds[i], from + bounds[i + 1], to + bounds[i]);
+            merged.push_back(bounds[i]);
+        }
+        merged.push_back(n);
+        for (auto& worker : workers) worker.join();
+        bounds = std::move(merged);
+        std::swap(from, to);
+    }
+    if (from != data) std::copy(from, from + n, data);
+}
+
+} // namespace
+
+void sort_numbers(double* data, size_t n) {
+    size_t threads = std::thread::hardware_concurrency();
+    if (n >= kParallelThreshold && threads > 1) {
+        parallel_sort(data, n, threads);
+    } else {
+        sort_chunk(data, n);
+    }
+}
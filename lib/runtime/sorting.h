@@ -0,0 +1,8 @@
+// сортировка массивов чисел
+#pragma once
+#include <cstddef>
+
+// короткие массивы сортируются std::sort, длинные - поразрядной LSD-сортировкой,
+// а очень длинные - параллельно: куски сортируются поразрядно в отдельных потоках
+// и затем попарно сливаются
+void sort_numbers(double* data, size_t n);
@@ -0,0 +1,157 @@
+// строковое значение языка
+#pragma once
+#include "pool.h"
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// строка - участок [offset, offset + length) общего неизменяемого буфера:
+// срезы разделяют буфер родителя и продлевают ему жизнь, ничего не копируя.
+// буфер - начало символов, владелец которых может быть любым (std::string, отображенный файл).
+// исключение - буфер с запасом, который создает append: пока на него ссылается только
+// одна строка, append дописывает символы в его конец
+class Str {
+public:
+    static constexpr size_t npos = std::string::npos;
+
+    Str() = default;
+    Str(std::string s) {
+        if (s.empty()) return;
+        len_ = s.size();
+        if (len_ <= kPooledLength) {
+            // короткий буфер вместе с блоком управления - один блок пула интерпретатора
+            auto chars = std::allocate_shared<char[]>(PoolAllocator<char>(), len_);
+            char* data = chars.get();
+            std::memcpy(data, s.data(), len_);
+            buf_ = std::shared_ptr<const char>(std::move(chars), data);
+        } else {
+            auto owner = std::make_shared<std::string>(std::move(s));
+            buf_ = std::shared_ptr<const char>(owner, owner->data());
+        }
+    }
+    Str(const char* s) : Str(std::string(s)) {}
+    explicit Str(std::string_view s) : Str(std::string(s)) {}
+    // участок уже существующего буфера, например прочитанного блока ввода или отображенного файла
+    Str(std::shared_ptr<const char> buffer, size_t offset, size_t length)
+        : buf_(length ? std::move(buffer) : nullptr), off_(length ? offset : 0), len_(length) {}
+    Str(const std::shared_ptr<std::string>& buffer, size_t offset, size_t length)
+        : Str(std::shared_ptr<const char>(buffer, buffer->data()), offset, length) {}
+
+    // односимвольные строки берутся из общей таблицы без выделения памяти
+    static const Str& from_char(char c) {
+        static const auto table = [] {
+            auto owner = std::make_shared<std::string>(256, '\0');
+            for (size_t i = 0; i < 256; ++i) (*owner)[i] = static_cast<char>(i);
+            std::shared_ptr<const char> chars(owner, owner->data());
+            std::unique_ptr<Str[]> result(new Str[256]);
+            for (size_t i = 0; i < 256; ++i) {
+                result[i].buf_ = chars;
+                result[i].off_ = i;
+                result[i].len_ = 1;
+            }
+            return result;
+        }();
+        return table[static_cast<unsigned char>(c)];
+    }
+
+    const char* data() const { return buf_ ? buf_.get() + offset() : ""; }
+    size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+    char operator[](size_t i) const { return data()[i]; }
+    std::string_view view() const { return {data(), len_}; }
+    operator std::string_view() const { return view(); }
+    std::string str() const { return std::string(view()); }
+
+    // подстрока без копирования: разделяет буфер с исходной строкой
+    Str substr(size_t pos, size_t count = npos) const {
+        if (pos > len_) pos = len_;
+        if (count > len_ - pos) count = len_ - pos;
+        if (count == 1) return from_char(data()[pos]);
+        Str result;
+        if (count > 0) {
+            result.buf_ = buf_;
+            result.off_ = offset() + pos; // срез не владеет запасом буфера
+            result.len_ = count;
+        }
+        return result;
+    }
+
+    // дописывание на место (s += x): символы копируются в запас собственного буфера,
+    // а при его нехватке строка переезжает в новый буфер с удвоенным запасом
+    void append(std::string_view text) {
+        if (text.empty()) return;
+        std::shared_ptr<const char> old; // text может указывать в старый буфер
+        if (spare() < text.size()) {
+            old = buf_;
+            grow(std::max(2 * (len_ + text.size()), kMinCapacity));
+        }
+        append_unchecked(text);
+    }
+    // повторение на месте (s *= times); times > 0
+    void repeat(size_t times) {
+        if (len_ == 0 || times == 1) return;
+        size_t unit = len_;
+        if (times > (PTRDIFF_MAX - sizeof(GrowableHeader)) / unit) throw std::runtime_error("Слишком длинная строка");
+        size_t total = unit * times;
+        if (spare() < total - unit) grow(total);
+        char* chars = const_cast<char*>(buf_.get());
+        for (size_t done = unit; done < total;) {
+            size_t n = std::min(done, total - done);
+            std::memcpy(chars + done, chars, n);
+            done += n;
+        }
+        header()->used = len_ = total;
+    }
+
+    friend bool operator==(const Str& a, const Str& b) { return a.view() == b.view(); }
+    friend std::strong_ordering operator<=>(const Str& a, const Str& b) { return a.view() <=> b.view(); }
+
+private:
+    static constexpr size_t kPooledLength = 256; // длиннее - буфер std::string из общей кучи
+    static constexpr size_t kMinCapacity = 32;
+    static constexpr size_t kGrowable = size_t(1) << (sizeof(size_t) * 8 - 1); // флаг в off_: буфер с запасом
+
+    // заголовок буфера с запасом, лежит прямо перед символами
+    struct alignas(16) GrowableHeader {
+        size_t capacity;
+        size_t used;
+    };
+
+    size_t offset() const { return off_ & ~kGrowable; }
+    GrowableHeader* header() const {
+        return reinterpret_cast<GrowableHeader*>(const_cast<char*>(buf_.get())) - 1;
+    }
+    // сколько символов можно дописать на место; 0, если буфер общий или без запаса
+    size_t spare() const {
+        if (!(off_ & kGrowable) || buf_.use_count() != 1) return 0;
+        const GrowableHeader* h = header();
+        return len_ == h->used ? h->capacity - h->used : 0;
+    }
+    // перенос строки в собственный буфер с запасом на capacity символов
+    void grow(size_t capacity) {
+        size_t bytes = sizeof(GrowableHeader) + capacity;
+        std::shared_ptr<char[]> block = bytes <= HeapPool::kMaxBlockSize
+            ? std::allocate_shared_for_overwrite<char[]>(PoolAllocator<char>(), bytes)
+            : std::make_shared_for_overwrite<char[]>(bytes);
+        char* chars = block.get() + sizeof(GrowableHeader);
+        new (block.get()) GrowableHeader{capacity, len_};
+        if (len_) std::memcpy(chars, data(), len_);
+        buf_ = std::shared_ptr<const char>(std::move(block), chars);
+        off_ = kGrowable;
+    }
+    void append_unchecked(std::string_view text) {
+        std::memcpy(const_cast<char*>(buf_.get()) + len_, text.data(), text.size());
+        len_ += text.size();
+        header()->used = len_;
+    }
+
+    std::shared_ptr<const char> buf_;
+    size_t off_ = 0;
+    size_t len_ = 0;
+};
@@ -0,0 +1,180 @@
+#include "string_kernels.h"
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define DFS_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using FindFn = size_t (*)(const char* s, size_t n, const char* needle, size_t k);
+using CaseFn = void (*)(char* s, size_t n, char lo, char hi);
+
+size_t find_scalar(const char* s, size_t n, const char* needle, size_t k) {
+    return std::string_view(s, n).find(std::string_view(needle, k));
+}
+
+void case_scalar(char* s, size_t n, char lo, char hi) { // переключает регистр байтов из [lo, hi]
+    for (size_t i = 0; i < n; ++i) {
+        if (s[i] >= lo && s[i] <= hi) s[i] ^= 0x20;
+    }
+}
+
+#ifdef DFS_X86_KERNELS
+// поиск кандидатов сразу в 16/32 позициях: совпадение первого и последнего
+// байтов образца, затем проверка кандидата через memcmp
+
+__attribute__((target("sse2")))
+size_t find_sse2(const char* s, size_t n, const char* needle, size_t k) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[k - 1]);
+    size_t i = 0;
+    for (; i + k + 15 <= n; i += 16) {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + k - 1));
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (std::memcmp(s + i + bit, needle, k) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = find_scalar(s + i, n - i, needle, k);
+    return rest == std::string_view::npos ? rest : i + rest;
+}
+
+__attribute__((target("avx2")))
+size_t find_avx2(const char* s, size_t n, const char* needle, size_t k) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[k - 1]);
+    size_t i = 0;
+    for (; i + k + 31 <= n; i += 32) {
+        __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + k - 1));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last)));
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (std::memcmp(s + i + bit, needle, k) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = find_sse2(s + i, n - i, needle, k);
+    return rest == std::string_view::npos ? rest : i + rest;
+}
+
+// байты из [lo, hi] получают xor 0x20; байты >= 0x80 отрицательны и в диапазон не попадают
+__attribute__((target("sse2")))
+void case_sse2(char* s, size_t n, char lo, char hi) {
+    const __m128i below = _mm_set1_epi8(static_cast<char>(lo - 1));
+    const __m128i above = _mm_set1_epi8(static_cast<char>(hi + 1));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(block, below), _mm_cmpgt_epi8(above, block));
+        block = _mm_xor_si128(block, _mm_and_si128(in_range, flip));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(s + i), block);
+    }
+    case_scalar(s + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2")))
+void case_avx2(char* s, size_t n, char lo, char hi) {
+    const __m256i below = _mm256_set1_epi8(static_cast<char>(lo - 1));
+    const __m256i above = _mm256_set1_epi8(static_cast<char>(hi + 1));
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i in_range = _mm256_and_si256(_mm256_cmpgt_epi8(block, below), _mm256_cmpgt_epi8(above, block));
+        block = _mm256_xor_si256(block, _mm256_and_si256(in_range, flip));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(s + i), block);
+    }
+    case_sse2(s + i, n - i, lo, hi);
+}
+#endif
+
+struct Kernels {
+    FindFn find = find_scalar;
+    CaseFn change_case = case_scalar;
+
+    Kernels() {
+#ifdef DFS_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            find = find_avx2;
+            change_case = case_avx2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            find = find_sse2;
+            change_case = case_sse2;
+        }
+#endif
+    }
+};
+
+const Kernels& kernels() {
+    static const Kernels instance;
+    return instance;
+}
+
+} // namespace
+
+size_t find_substring(std::string_view haystack, std::string_view needle, size_t from) {
+    if (from > haystack.size()) return std::string_view::npos;
+    if (needle.empty()) return from;
+    if (needle.size() > haystack.size() - from) return std::string_view::npos;
+    size_t pos = kernels().find(haystack.data() + from, haystack.size() - from, needle.data(), needle.size());
+    return pos == std::string_view::npos ? pos : from + pos;
+}
+
+void find_all(std::string_view haystack, std::string_view needle, std::vector<size_t>& positions) {
+    size_t pos = 0;
+    while ((pos = find_substring(haystack, needle, pos)) != std::string_view::npos) {
+        positions.push_back(pos);
+        pos += needle.size();
+    }
+}
+
+size_t count_substring(std::string_view haystack, std::string_view needle) {
+    if (needle.empty()) return haystack.size() + 1;
+    size_t count = 0;
+    size_t pos = 0;
+    while ((pos = find_substring(haystack, needle, pos)) != std::string_view::npos) {
+        ++count;
+        pos += needle.size();
+    }
+    return count;
+}
+
+std::string replace_all(std::string_view s, std::string_view from, std::string_view to) {
+    if (from.empty()) return std::string(s);
+    std::vector<size_t> positions;
+    find_all(s, from, positions);
+    std::string result;
+    result.resize(s.size() - positions.size() * from.size() + positions.size() * to.size());
+    char* out = result.data();
+    size_t last = 0;
+    for (size_t pos : positions) {
+        std::memcpy(out, s.data() + last, pos - last);
+        out += pos - last;
+        std::memcpy(out, to.data(), to.size());
+        out += to.size();
+        last = pos + from.size();
+    }
+    std::memcpy(out, s.data() + last, s.size() - last);
+    return result;
+}
+
+std::string ascii_lower(std::string_view s) {
+    std::string result(s);
+    kernels().change_case(result.data(), result.size(), 'A', 'Z');
+    return result;
+}
+
+std::string ascii_upper(std::string_view s) {
+    std::string result(s);
+    kernels().change_case(result.data(), result.size(), 'a', 'z');
+    return result;
+}
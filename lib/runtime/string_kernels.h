@@ -0,0 +1,20 @@
+// ядра поиска, замены и смены регистра строк
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+// реализация (AVX2, SSE2 или скалярная) выбирается один раз при первом вызове
+// в зависимости от возможностей процессора
+
+// позиция первого вхождения needle в haystack начиная с from, либо std::string_view::npos
+size_t find_substring(std::string_view haystack, std::string_view needle, size_t from = 0);
+// позиции всех непересекающихся вхождений needle (needle не пустая)
+void find_all(std::string_view haystack, std::string_view needle, std::vector<size_t>& positions);
+// количество непересекающихся вхождений needle
+size_t count_substring(std::string_view haystack, std::string_view needle);
+// замена всех вхождений за один проход с заранее вычисленным размером результата
+std::string replace_all(std::string_view s, std::string_view from, std::string_view to);
+// смена регистра латинских букв, остальные байты не меняются
+std::string ascii_lower(std::string_view s);
+std::string ascii_upper(std::string_view s);
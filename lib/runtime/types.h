@@ -4,26 +4,307 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <stdexcept>
 #include "parser/ast.h"
+#include "hash_table.h"
+#include "str.h"
+#include "ref.h"
+#include "gc.h"
 using NullType = std::monostate; // пустая структура 
 
 // предварительное объявление структур для хранения значений
 struct ListValue;
 struct FunctionValue;
+struct MapValue;
+struct SetValue;
+struct BuilderValue;
+struct ArrayValue;
+struct IteratorValue;
 
-// псевдонимы для списка, функции и варианта Value
-using List = std::shared_ptr<ListValue>;
-using Function = std::shared_ptr<FunctionValue>;
-using Value = std::variant<NullType, double, std::string, List, Function>;
+// псевдонимы для списка, функции, словаря, множества, построителя строк, массива, итератора и варианта Value
+using List = Ref<ListValue>;
+using Function = Ref<FunctionValue>;
+using Map = Ref<MapValue>;
+using Set = std::shared_ptr<SetValue>;
+using Builder = std::shared_ptr<BuilderValue>;
+using Array = std::shared_ptr<ArrayValue>;
+using Iterator = std::shared_ptr<IteratorValue>;
+using Value = std::variant<NullType, double, Str, List, Function, Map, Set, Builder, Array, Iterator>;
 
-// определение типов значений списка и функции
-struct ListValue {
-    std::vector<Value> elements;
+// хеширование и сравнение ключей словаря и элементов множества (допустимы числа и строки)
+struct ValueHash {
+    size_t operator()(const Value& key) const;
 };
 
-struct FunctionValue {
+struct ValueKeyEqual {
+    bool operator()(const Value& a, const Value& b) const;
+};
+
+// определение типов значений списка, функции, словаря, множества и построителя строк
+// хранилище элементов списка: пока все элементы - числа, они лежат
+// неупакованными в numbers, иначе - в общем виде в values
+struct ListStorage : GcObject {
+    bool packed = true;
+    PooledVector<double> numbers;
+    PooledVector<Value> values;
+
+    size_t size() const { return packed ? numbers.size() : values.size(); }
+    void freeze() {
+        mark_frozen();
+        untrack();
+    }
+    void collect_children(std::vector<GcObject*>& out) const override;
+    void clear_children() override { PooledVector<Value>().swap(values); }
+};
+
+// список - окно [offset, offset + length) общего хранилища элементов:
+// срез разделяет хранилище родителя, а копия делается при первом изменении
+struct ListValue : GcObject {
+    ListValue() : storage_(make_ref<ListStorage>()) {}
+    explicit ListValue(PooledVector<Value> elements) : storage_(make_ref<ListStorage>()) {
+        storage_->packed = false;
+        storage_->values = std::move(elements);
+        length_ = storage_->values.size();
+    }
+    explicit ListValue(PooledVector<double> numbers) : storage_(make_ref<ListStorage>()) {
+        storage_->numbers = std::move(numbers);
+        length_ = storage_->numbers.size();
+    }
+    explicit ListValue(const std::vector<double>& numbers)
+        : ListValue(PooledVector<double>(numbers.begin(), numbers.end())) {}
+    ListValue(Ref<ListStorage> storage, size_t offset, size_t length)
+        : storage_(std::move(storage)), offset_(offset), length_(length) {}
+
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    bool packed() const { return storage_->packed; }
+    Value get(size_t i) const {
+        if (storage_->packed) return storage_->numbers[offset_ + i];
+        return storage_->values[offset_ + i];
+    }
+    // числа упакованного списка
+    const double* numbers() const { return storage_->numbers.data() + offset_; }
+
+    // срез [start, end) без копирования элементов
+    List slice(size_t start, size_t end) const {
+        if (start >= end) return make_ref<ListValue>();
+        return make_ref<ListValue>(storage_, offset_ + start, end - start);
+    }
+
+    // доступ на изменение в общем виде: отделяет список и переводит его в values
+    PooledVector<Value>& elements() {
+        detach();
+        if (storage_->packed) {
+            auto& values = storage_->values;
+            values.reserve(storage_->numbers.size());
+            for (double num : storage_->numbers) values.emplace_back(num);
+            storage_->numbers = PooledVector<double>();
+            storage_->packed = false;
+        }
+        return storage_->values;
+    }
+    // доступ на изменение упакованного списка
+    PooledVector<double>& mutable_numbers() {
+        detach();
+        return storage_->numbers;
+    }
+    void push(Value v) {
+        if (storage_->packed && std::holds_alternative<double>(v)) {
+            mutable_numbers().push_back(std::get<double>(v));
+        } else {
+            elements().push_back(std::move(v));
+        }
+        ++length_;
+    }
+    void pop() {
+        detach();
+        if (storage_->packed) {
+            storage_->numbers.pop_back();
+        } else {
+            storage_->values.pop_back();
+        }
+        --length_;
+    }
+    void insert(size_t i, Value v) {
+        if (storage_->packed && std::holds_alternative<double>(v)) {
+            auto& items = mutable_numbers();
+            items.insert(items.begin() + i, std::get<double>(v));
+        } else {
+            auto& items = elements();
+            items.insert(items.begin() + i, std::move(v));
+        }
+        ++length_;
+    }
+    void erase(size_t i) {
+        detach();
+        if (storage_->packed) {
+            storage_->numbers.erase(storage_->numbers.begin() + i);
+        } else {
+            storage_->values.erase(storage_->values.begin() + i);
+        }
+        --length_;
+    }
+    void append(const ListValue& other) {
+        if (&other == this) {
+            ListValue copy(storage_, offset_, length_);
+            append(copy);
+            return;
+        }
+        if (storage_->packed && other.packed()) {
+            auto& items = mutable_numbers();
+            items.insert(items.end(), other.numbers(), other.numbers() + other.size());
+        } else {
+            auto& items = elements();
+            for (size_t i = 0; i < other.size(); ++i) items.push_back(other.get(i));
+        }
+        length_ += other.size();
+    }
+    // список повторяется times раз подряд (0 - очищается)
+    void repeat(size_t times) {
+        detach();
+        if (storage_->packed) {
+            repeat_items(storage_->numbers, times);
+        } else {
+            repeat_items(storage_->values, times);
+        }
+        length_ *= times;
+    }
+    // заморозка для разделения между потоками: список и вложенные в него списки и функции
+    // становятся неизменяемыми и переходят на атомарные счетчики ссылок
+    void freeze();
+    void collect_children(std::vector<GcObject*>& out) const override {
+        if (storage_) out.push_back(storage_.get());
+    }
+    void clear_children() override { storage_.reset(); }
+    void reserve(size_t n) {
+        detach();
+        if (storage_->packed) {
+            storage_->numbers.reserve(n);
+        } else {
+            storage_->values.reserve(n);
+        }
+    }
+
+private:
+    Ref<ListStorage> storage_;
+    size_t offset_ = 0;
+    size_t length_ = 0;
+
+    // делает хранилище собственным и совпадающим с окном списка
+    void detach() {
+        if (frozen()) throw std::runtime_error("Замороженный список нельзя изменить");
+        if (storage_.use_count() > 1) {
+            auto copy = make_ref<ListStorage>();
+            copy->packed = storage_->packed;
+            if (storage_->packed) {
+                copy->numbers.assign(storage_->numbers.begin() + offset_, storage_->numbers.begin() + offset_ + length_);
+            } else {
+                copy->values.assign(storage_->values.begin() + offset_, storage_->values.begin() + offset_ + length_);
+            }
+            storage_ = std::move(copy);
+            offset_ = 0;
+        } else if (offset_ != 0 || length_ != storage_->size()) {
+            if (storage_->packed) {
+                trim(storage_->numbers);
+            } else {
+                trim(storage_->values);
+            }
+            offset_ = 0;
+        }
+    }
+    template <typename Items>
+    static void repeat_items(Items& items, size_t times) {
+        size_t n = items.size();
+        if (times == 0) {
+            items.clear();
+            return;
+        }
+        if (n != 0 && times > items.max_size() / n) throw std::runtime_error("Слишком длинный список");
+        items.reserve(n * times);
+        for (size_t t = 1; t < times; ++t) {
+            for (size_t i = 0; i < n; ++i) items.push_back(items[i]);
+        }
+    }
+    template <typename Items>
+    void trim(Items& items) {
+        items.resize(offset_ + length_);
+        items.erase(items.begin(), items.begin() + offset_);
+    }
+};
+
+struct FunctionValue : RefCounted {
     std::vector<std::string> parameters;
     std::vector<const ASTNode*> body;
+    size_t frame_size = 0; // ячеек в кадре вызова (не меньше числа параметров)
+    const FunctionNode* node = nullptr; // определение: имя функции для стека вызовов
+
+    void freeze() { mark_frozen(); }
+};
+
+inline void ListValue::freeze() {
+    if (frozen()) return; // список может содержать сам себя
+    mark_frozen();
+    untrack();
+    storage_->freeze();
+    if (storage_->packed) return;
+    for (const Value& item : storage_->values) {
+        if (auto list = std::get_if<List>(&item)) (*list)->freeze();
+        if (auto function = std::get_if<Function>(&item)) (*function)->freeze();
+    }
+}
+
+// кэш InvariantNode на время одного выполнения цикла
+struct InvariantCache {
+    enum class State {
+        Empty,      // еще не вычислялось
+        Cached,     // value можно переиспользовать
+        Uncacheable // значение изменяемо или зависит от изменяемых входов: вычисляется каждый раз
+    };
+    State state = State::Empty;
+    Value value;
+};
+
+struct MapValue : GcObject {
+    HashTable<Value, Value, ValueHash, ValueKeyEqual> table;
+
+    // ключи - числа и строки, на другие объекты могут ссылаться только значения
+    void collect_children(std::vector<GcObject*>& out) const override {
+        table.for_each([&](const Value&, const Value& value) {
+            if (auto list = std::get_if<List>(&value)) out.push_back(list->get());
+            if (auto map = std::get_if<Map>(&value)) out.push_back(map->get());
+        });
+    }
+    void clear_children() override { table.clear(); }
+};
+
+inline void ListStorage::collect_children(std::vector<GcObject*>& out) const {
+    if (packed) return;
+    for (const Value& item : values) {
+        if (auto list = std::get_if<List>(&item)) out.push_back(list->get());
+        if (auto map = std::get_if<Map>(&item)) out.push_back(map->get());
+    }
+}
+
+struct NoValue {}; // у элементов множества нет связанного значения
+
+struct SetValue {
+    HashTable<Value, NoValue, ValueHash, ValueKeyEqual> table;
+};
+
+// изменяемый буфер для сборки строки: дописывание за амортизированное O(1)
+struct BuilderValue {
+    std::string buffer;
+};
+
+// массив чисел: непрерывный буфер, операторы над которым действуют поэлементно
+struct ArrayValue {
+    std::vector<double> data;
+};
+
+// ленивый итератор: элементы вычисляются по одному при обходе циклом for
+struct IteratorValue {
+    virtual ~IteratorValue() = default;
+    virtual bool next(Value& out) = 0; // false, когда элементы закончились
 };
 
 struct ReturnException {
@@ -33,4 +314,4 @@ struct ReturnException {
 struct BreakException {};
 struct ContinueException {};
 
-extern std::vector<Value>* g_print_values;
\ No newline at end of file
+extern thread_local std::vector<Value>* g_print_values;
\ No newline at end of file
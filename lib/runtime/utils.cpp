@@ -1,10 +1,17 @@
 #include "utils.h"
+#include <charconv>
 #include <sstream>
 #include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 
 std::string format_number(double num) { // преобразование числа в праивьную строку (без 0 в конце)
-    if (num == static_cast<int>(num)) {
-        return std::to_string(static_cast<int>(num));
+    int64_t integer;
+    if (exact_int64(num, integer)) {
+        char digits[20];
+        return std::string(digits, std::to_chars(digits, digits + sizeof(digits), integer).ptr);
     }
     
     std::ostringstream ss;
@@ -25,7 +32,116 @@ std::string format_number(double num) { // преобразование числ
 bool isTruthy(const Value& v) { // является ли значение истинным в логическом контексте
     if (std::holds_alternative<NullType>(v)) return false;
     if (std::holds_alternative<double>(v)) return std::get<double>(v) != 0.0;
-    if (std::holds_alternative<std::string>(v)) return !std::get<std::string>(v).empty();
-    if (std::holds_alternative<List>(v)) return !std::get<List>(v)->elements.empty();
+    if (std::holds_alternative<Str>(v)) return !std::get<Str>(v).empty();
+    if (std::holds_alternative<List>(v)) return !std::get<List>(v)->empty();
+    if (std::holds_alternative<Map>(v)) return !std::get<Map>(v)->table.empty();
+    if (std::holds_alternative<Set>(v)) return !std::get<Set>(v)->table.empty();
+    if (std::holds_alternative<Builder>(v)) return !std::get<Builder>(v)->buffer.empty();
+    if (std::holds_alternative<Array>(v)) return !std::get<Array>(v)->data.empty();
     return false;
-}
\ No newline at end of file
+}
+
+bool is_hashable(const Value& v) {
+    return std::holds_alternative<double>(v) || std::holds_alternative<Str>(v);
+}
+
+size_t ValueHash::operator()(const Value& key) const {
+    if (std::holds_alternative<double>(key)) {
+        double num = std::get<double>(key);
+        if (num == 0.0) num = 0.0; // -0.0 и 0.0 - один ключ
+        uint64_t bits;
+        std::memcpy(&bits, &num, sizeof(bits));
+        bits ^= bits >> 33;
+        bits *= 0xff51afd7ed558ccdULL;
+        bits ^= bits >> 33;
+        return static_cast<size_t>(bits);
+    }
+    if (std::holds_alternative<Str>(key)) {
+        return std::hash<std::string_view>{}(std::get<Str>(key).view());
+    }
+    return 0;
+}
+
+bool ValueKeyEqual::operator()(const Value& a, const Value& b) const { // контейнеры и функции сравниваются по ссылке
+    return a == b;
+}
+
+// active - списки и словари, которые выводятся сейчас: контейнер, содержащий сам себя,
+// на повторной встрече выводится как [...] или {...}
+static void write_value(std::ostream& out, const Value& v, bool nested, std::vector<const void*>& active) {
+    auto enter = [&](const void* container) {
+        if (std::find(active.begin(), active.end(), container) != active.end()) return false;
+        active.push_back(container);
+        return true;
+    };
+    if (std::holds_alternative<NullType>(v)) {
+        out << "nil";
+    } else if (std::holds_alternative<double>(v)) {
+        out << format_number(std::get<double>(v));
+    } else if (std::holds_alternative<Str>(v)) {
+        if (nested) {
+            out << "\"" << std::get<Str>(v).view() << "\"";
+        } else {
+            out << std::get<Str>(v).view();
+        }
+    } else if (std::holds_alternative<List>(v)) {
+        const List& list = std::get<List>(v);
+        if (!enter(list.get())) {
+            out << "[...]";
+            return;
+        }
+        out << "[";
+        for (size_t i = 0; i < list->size(); ++i) {
+            if (i > 0) out << ", ";
+            write_value(out, list->get(i), true, active);
+        }
+        out << "]";
+        active.pop_back();
+    } else if (std::holds_alternative<Array>(v)) {
+        const auto& data = std::get<Array>(v)->data;
+        out << "[";
+        for (size_t i = 0; i < data.size(); ++i) {
+            if (i > 0) out << ", ";
+            out << format_number(data[i]);
+        }
+        out << "]";
+    } else if (std::holds_alternative<Map>(v)) {
+        const Map& map = std::get<Map>(v);
+        if (!enter(map.get())) {
+            out << "{...}";
+            return;
+        }
+        out << "{";
+        bool first = true;
+        map->table.for_each([&](const Value& key, const Value& value) {
+            if (!first) out << ", ";
+            first = false;
+            write_value(out, key, true, active);
+            out << ": ";
+            write_value(out, value, true, active);
+        });
+        out << "}";
+        active.pop_back();
+    } else if (std::holds_alternative<Set>(v)) {
+        const Set& set = std::get<Set>(v);
+        if (set->table.empty()) { // "{}" - пустой словарь, поэтому пустое множество выводится как set()
+            out << "set()";
+            return;
+        }
+        out << "{";
+        bool first = true;
+        set->table.for_each([&](const Value& elem, const NoValue&) {
+            if (!first) out << ", ";
+            first = false;
+            write_value(out, elem, true, active);
+        });
+        out << "}";
+    } else if (std::holds_alternative<Builder>(v)) {
+        write_value(out, Str(std::get<Builder>(v)->buffer), nested, active);
+    }
+}
+
+void write_value(std::ostream& out, const Value& v, bool nested) { // строки внутри контейнеров выводятся в кавычках
+    std::vector<const void*> active;
+    write_value(out, v, nested, active);
+}
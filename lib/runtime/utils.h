@@ -1,6 +1,25 @@
 #pragma once
 #include "types.h"
+#include <cstdint>
 #include <string>
+#include <ostream>
+
+// целое значение числа, если оно точно представимо в int64 (NaN и бесконечности - нет)
+inline bool exact_int64(double num, int64_t& out) {
+    if (!(num >= -0x1p63 && num < 0x1p63)) return false;
+    auto integer = static_cast<int64_t>(num);
+    if (static_cast<double>(integer) != num) return false;
+    out = integer;
+    return true;
+}
+// индекс из числа: дробная часть отбрасывается, значения вне int64 и NaN насыщаются
+inline int64_t to_index(double num) {
+    if (num >= 0x1p63) return INT64_MAX;
+    if (!(num > -0x1p63)) return INT64_MIN;
+    return static_cast<int64_t>(num);
+}
 
 std::string format_number(double num);
-bool isTruthy(const Value& v);
\ No newline at end of file
+bool isTruthy(const Value& v);
+bool is_hashable(const Value& v); // может ли значение быть ключом словаря или элементом множества
+void write_value(std::ostream& out, const Value& v, bool nested = false); // вывод значения в поток
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+// Test array constructors
+TEST(ArrayTestSuite, Constructors) {
+    std::string code = R"(
+        print(array([1, 2.5, -3]))
+        print(zeros(3))
+        print(linspace(0, 1, 5))
+        print(len(linspace(2, 3, 1)))
+        print(to_list(array(range(3))) + [nil])
+    )";
+    std::string expected = "[1, 2.5, -3][0, 0, 0][0, 0.25, 0.5, 0.75, 1]1[0, 1, 2, nil]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test elementwise arithmetic with arrays and scalars
+TEST(ArrayTestSuite, ElementwiseArithmetic) {
+    std::string code = R"(
+        a = array(range(1, 7))
+        b = linspace(6, 1, 6)
+        print(a + b)
+        print(a - 1)
+        print(10 - a)
+        print(a * b / 2)
+        print(a ^ 2)
+        print(-a % 4)
+        print(a)
+    )";
+    std::string expected = "[7, 7, 7, 7, 7, 7][0, 1, 2, 3, 4, 5][9, 8, 7, 6, 5, 4][3, 5, 6, 6, 5, 3]"
+                           "[1, 4, 9, 16, 25, 36][-1, -2, -3, 0, -1, -2][1, 2, 3, 4, 5, 6]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that temporaries are reused without touching arrays held by variables
+TEST(ArrayTestSuite, ChainedExpressions) {
+    std::string code = R"(
+        x = linspace(0, 9, 10)
+        y = (x * 2 + 1) * (x - 1) / 2
+        z = 1 + x * 0
+        print(y)
+        print(x)
+        print(z)
+        print(sum(x * x))
+    )";
+    std::string expected = "[-0.5, 0, 2.5, 7, 13.5, 22, 32.5, 45, 59.5, 76][0, 1, 2, 3, 4, 5, 6, 7, 8, 9]"
+                           "[1, 1, 1, 1, 1, 1, 1, 1, 1, 1]285";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test elementwise comparisons, indexing, slicing and iteration
+TEST(ArrayTestSuite, ComparisonsIndexingIteration) {
+    std::string code = R"(
+        a = array([4, 8, 15, 16, 23, 42])
+        mask = a > 15
+        print(mask)
+        print(sum(mask))
+        print(a == 16)
+        print(!(a < 20))
+        print(a[-1])
+        print(a[10])
+        print(a[1:3])
+        print(23 in a)
+        total = 0
+        for v in a
+            total += v
+        end for
+        print(total)
+        print(a == nil)
+    )";
+    std::string expected = "[0, 0, 0, 1, 1, 1]3[0, 0, 0, 1, 0, 0][0, 0, 0, 0, 1, 1]42nil[8, 15]11080";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test long arrays against reductions
+TEST(ArrayTestSuite, LongArrays) {
+    std::string code = R"(
+        x = linspace(1, 100000, 100000)
+        print(sum(x + x))
+        print(max(x * -1))
+        print(count_if_gt(x / 1000, 50))
+        print(dot(x, zeros(100000) + 1))
+    )";
+    std::string expected = "10000100000-1500005000050000";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test array errors: length mismatch and division by zero
+TEST(ArrayTestSuite, Errors) {
+    for (const std::string code : {"print(zeros(2) + zeros(3))", "print(array([1, 2]) / array([1, 0]))",
+                                   "print(zeros(2) + [1, 2])", "print(array([1, \"a\"]))"}) {
+        std::istringstream input(code);
+        std::ostringstream output;
+        ASSERT_FALSE(interpret(input, output));
+    }
+}
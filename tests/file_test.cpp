@@ -0,0 +1,139 @@
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("dfs_file_test_" + name)).string();
+}
+
+} // namespace
+
+// Test write_file, append_file and read_file; pending writes are visible to reads
+TEST(FileTestSuite, WriteAppendRead) {
+    std::string path = temp_path("write.txt");
+    std::string code = R"(
+        path = ")" + path + R"("
+        write_file(path, "first")
+        append_file(path, "\n")
+        for i in range(3)
+            append_file(path, i)
+        end for
+        print(read_file(path))
+        write_file(path, "new")
+        append_file(path, [1, "a"])
+        print("|" + read_file(path))
+    )";
+    std::string expected = "first\n012|new[1, \"a\"]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+    std::filesystem::remove(path);
+}
+
+// Test writes are flushed when the script ends
+TEST(FileTestSuite, FlushOnExit) {
+    std::string path = temp_path("flush.txt");
+    std::string code = R"(
+        for i in range(1000)
+            append_file(")" + path + R"(", "x")
+        end for
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    std::filesystem::remove(path);
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(std::filesystem::file_size(path), 1000u);
+    std::filesystem::remove(path);
+}
+
+// Test that spellings of one path share a writer and reads see its pending writes
+TEST(FileTestSuite, SamePathSpellings) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::string path = (dir / "dfs_file_test_alias.txt").string();
+    std::string alias = (dir / "." / "dfs_file_test_alias.txt").string();
+    std::string code = R"(
+        write_file(")" + path + R"(", "hello")
+        print(read_file(")" + alias + R"("))
+        append_file(")" + alias + R"(", " world")
+        append_file(")" + path + R"(", "!")
+        print(len(read_file(")" + alias + R"(")))
+        for line in file_lines(")" + alias + R"(")
+            print(line)
+        end for
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "hello12hello world!");
+    std::filesystem::remove(path);
+}
+
+// Test file_lines on a small file and on a file large enough to be memory-mapped
+TEST(FileTestSuite, FileLines) {
+    std::string small = temp_path("small.txt");
+    std::string large = temp_path("large.txt");
+    {
+        std::ofstream(small) << "a\r\nbb\n\nccc";
+        std::ofstream out(large);
+        for (int i = 0; i < 100000; ++i) out << "row " << i << ",payload payload\n";
+        out << "tail";
+    }
+    std::string code = R"(
+        print(to_list(file_lines(")" + small + R"(")))
+        count = 0
+        last = ""
+        for line in file_lines(")" + large + R"(")
+            count += 1
+            last = line
+        end for
+        print(count)
+        print(last)
+    )";
+    std::string expected = "[\"a\", \"bb\", \"\", \"ccc\"]100001tail";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+    std::filesystem::remove(small);
+    std::filesystem::remove(large);
+}
+
+// Test that rewriting a file keeps lines taken from its mapping intact
+TEST(FileTestSuite, RewriteWhileLinesAlive) {
+    std::string path = temp_path("rewrite.txt");
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < 200000; ++i) out << "line " << i << "\n";
+    }
+    std::string code = R"(
+        path = ")" + path + R"("
+        first = to_list(file_lines(path))
+        write_file(path, "short")
+        print(first[0] + "/" + first[-1] + "/" + read_file(path))
+    )";
+    std::string expected = "line 0/line 199999/short";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+    std::filesystem::remove(path);
+}
+
+// Test that a missing file is an error
+TEST(FileTestSuite, MissingFile) {
+    for (const std::string code : {"print(read_file(\"/nonexistent/dfs/file\"))", "print(file_lines(\"/nonexistent/dfs/file\"))"}) {
+        std::istringstream input(code);
+        std::ostringstream output;
+        ASSERT_FALSE(interpret(input, output));
+    }
+}
@@ -227,4 +227,310 @@ TEST(FunctionTestSuite, FunctionAsArgument) {
 
     ASSERT_TRUE(interpret(input, output));
     ASSERT_EQ(output.str(), expected);
-}
\ No newline at end of file
+}
+
+// Test that functions see global variables and can call themselves recursively
+TEST(FunctionTestSuite, RecursionAndGlobals) {
+    std::string code = R"(
+        base = 100
+        fib = function(n)
+            if n < 2 then return n end if
+            return fib(n - 1) + fib(n - 2)
+        end function
+        shifted = function(x) return x + base end function
+        print(fib(20))
+        print(shifted(1))
+        base = 200
+        print(shifted(1))
+    )";
+
+    std::string expected = "6765101201";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that assignments inside a function create locals for the whole call
+TEST(FunctionTestSuite, LocalVariables) {
+    std::string code = R"(
+        x = 1
+        set_x = function(v)
+            x = v
+            for i in range(3)
+                x += i
+            end for
+            return x
+        end function
+        print(set_x(10))
+        print(x)
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "131");
+
+    std::string loop_variable = R"(
+        count = function()
+            for i in range(3)
+            end for
+            return i
+        end function
+        print(count())
+        print(i)
+    )";
+    std::istringstream input1(loop_variable);
+    std::ostringstream output1;
+    ASSERT_FALSE(interpret(input1, output1));
+    ASSERT_EQ(output1.str(), "Ошибка: Неопределенная переменная: i");
+
+    std::string before_assignment = R"(
+        x = 1
+        f = function()
+            y = x
+            x = 2
+            return y
+        end function
+        print(f())
+    )";
+    std::istringstream input2(before_assignment);
+    std::ostringstream output2;
+    ASSERT_FALSE(interpret(input2, output2));
+    ASSERT_EQ(output2.str(), "Ошибка: Неопределенная переменная: x\nСтек вызовов: f (строка 8)");
+}
+
+// Test that each recursive call gets its own frame and control flow leaves loops correctly
+TEST(FunctionTestSuite, FramesAndControlFlow) {
+    std::string code = R"(
+        find = function(items, target)
+            for i in range(len(items))
+                if items[i] == target then return i end if
+            end for
+            return -1
+        end function
+        depth = function(n)
+            local_value = n * 10
+            if n > 0 then depth(n - 1) end if
+            return local_value
+        end function
+        base = 1
+        items = [3, 1, 2]
+        sort(items, function(a) return -a * base end function)
+        print(find([5, 6, 7], 7))
+        print(find([5, 6, 7], 9))
+        print(depth(500))
+        print(items[0] * 100 + items[1] * 10 + items[2])
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "2-15000321");
+
+    std::istringstream bad_break("bad = function() break end function bad()");
+    std::ostringstream error_output;
+    ASSERT_FALSE(interpret(bad_break, error_output));
+    ASSERT_EQ(error_output.str(), "Ошибка: break вне цикла\nСтек вызовов: bad (строка 1)");
+}
+
+// Test that tail calls run in constant stack, including mutual recursion and nested calls in arguments
+TEST(FunctionTestSuite, TailCalls) {
+    std::string code = R"(
+        loop = function(i, acc)
+            if i == 0 then return acc end if
+            return loop(i - 1, acc + i)
+        end function
+        even = function(n)
+            if n == 0 then return "even" end if
+            return odd(n - 1)
+        end function
+        odd = function(n)
+            if n == 0 then return "odd" end if
+            return even(n - 1)
+        end function
+        wide = function(a, b, c)
+            extra = a + b + c
+            return narrow(extra)
+        end function
+        narrow = function(x) return x * 2 end function
+        outer = function(n) return loop(loop(n, 0), 0) end function
+        print(loop(30000, 0))
+        print(even(20001))
+        print(wide(1, 2, 3))
+        print(outer(3))
+        print(len(to_string(loop(10, 0))))
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "450015000odd12212");
+
+    std::istringstream not_function("f = function() x = 5 return x() end function f()");
+    std::ostringstream error_output;
+    ASSERT_FALSE(interpret(not_function, error_output));
+    ASSERT_EQ(error_output.str(), "Ошибка: Неизвестный вызов функции\nСтек вызовов: f (строка 1)");
+}
+
+// Test that runaway recursion stops with an error and the call stack instead of overflowing the native stack
+TEST(FunctionTestSuite, RecursionDepthLimit) {
+    std::string code = R"(
+        deep = function(n) return 1 + deep(n + 1) end function
+        print(deep(0))
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_FALSE(interpret(input, output));
+    ASSERT_EQ(output.str().rfind("Ошибка: Превышена максимальная глубина рекурсии (", 0), 0u);
+
+    set_max_call_depth(3);
+    std::istringstream limited(code);
+    std::ostringstream limited_output;
+    ASSERT_FALSE(interpret(limited, limited_output));
+    set_max_call_depth(5000);
+    ASSERT_EQ(limited_output.str(), "Ошибка: Превышена максимальная глубина рекурсии (3)\n"
+                                    "Стек вызовов: deep (строка 3) -> deep (строка 2) -> deep (строка 2)");
+
+    std::istringstream after(code);
+    std::ostringstream after_output;
+    ASSERT_FALSE(interpret(after, after_output));
+    ASSERT_EQ(after_output.str(), output.str());
+}
+
+// Test that generator functions produce their elements lazily through for and to_list
+TEST(FunctionTestSuite, Generators) {
+    std::string code = R"(
+        count = function(n)
+            i = 0
+            while i < n
+                yield i
+                i += 1
+            end while
+        end function
+        evens = function(src)
+            for x in src
+                if x % 2 == 0 then yield x end if
+            end for
+        end function
+        total = 0
+        for v in evens(count(10))
+            total += v * v
+        end for
+        print(total)
+        g = count(3)
+        for x in g
+            print(x)
+        end for
+        for x in g
+            print(x)
+        end for
+        firsts = function(n)
+            for x in range(100)
+                if x >= n then break end if
+                if x == 1 then continue end if
+                yield x
+            end for
+            yield "done"
+            return 5
+            yield "never"
+        end function
+        print(to_list(firsts(4)))
+        nested = function()
+            for r in range(2)
+                for c in range(2)
+                    yield r * 10 + c
+                end for
+            end for
+        end function
+        print(to_list(nested()))
+        tail = function(n)
+            return count(n)
+        end function
+        print(len(to_list(tail(5))))
+    )";
+    std::string expected = "120012[0, 2, 3, \"done\"][0, 1, 10, 11]5";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that suspended generators of one function keep separate frames and loop state
+TEST(FunctionTestSuite, GeneratorInstances) {
+    std::string code = R"(
+        count = function(n, step)
+            i = 0
+            while i < n * step
+                yield i + n * step
+                i += step
+            end while
+        end function
+        a = count(3, 1)
+        b = count(2, 10)
+        pairs = 0
+        for x in a
+            for y in b
+                pairs += x * y
+                break
+            end for
+        end for
+        print(pairs)
+        walk = function(n)
+            if n > 0 then
+                for x in walk(n - 1)
+                    yield x
+                end for
+            end if
+            yield n
+        end function
+        print(to_list(walk(4)))
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "180[0, 1, 2, 3, 4]");
+}
+
+// Test generator errors: yield outside a function, resuming a running generator, errors in the body
+TEST(FunctionTestSuite, GeneratorErrors) {
+    std::istringstream outside("yield 1");
+    std::ostringstream outside_output;
+    ASSERT_FALSE(interpret(outside, outside_output));
+    ASSERT_EQ(outside_output.str(), "Ошибка: yield вне функции");
+
+    std::istringstream reentrant(R"(
+        g = nil
+        loop = function()
+            for x in g
+                yield x
+            end for
+        end function
+        g = loop()
+        for y in g
+            print(y)
+        end for
+    )");
+    std::ostringstream reentrant_output;
+    ASSERT_FALSE(interpret(reentrant, reentrant_output));
+    ASSERT_EQ(reentrant_output.str(), "Ошибка: Генератор уже выполняется\nСтек вызовов: loop");
+
+    std::istringstream failing(R"(
+        bad = function()
+            yield 1
+            yield missing
+        end function
+        print(to_list(bad()))
+    )");
+    std::ostringstream failing_output;
+    ASSERT_FALSE(interpret(failing, failing_output));
+    ASSERT_EQ(failing_output.str(), "Ошибка: Неопределенная переменная: missing\nСтек вызовов: bad");
+}
@@ -117,3 +117,298 @@ TEST(ListFunctionsTestSuite, SortString) {
     ASSERT_TRUE(interpret(input, output));
     ASSERT_EQ(output.str(), expected);
 }
+
+// Test that a numeric list converts transparently on the first non-number store
+TEST(ListFunctionsTestSuite, NumericListBecomesMixed) {
+    std::string code = R"(
+        l = range(4)
+        s = l[1:3]
+        push(l, "x")
+        insert(s, 1, nil)
+        print(l)
+        print(s)
+        print(pop(l))
+        print(l[-1] + 1)
+    )";
+    std::string expected = "[0, 1, 2, 3][1, nil, 2]x4";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test operations on numeric lists: concatenation, sort, membership and iteration
+TEST(ListFunctionsTestSuite, NumericListOperations) {
+    std::string code = R"(
+        l = [5, 3.5, -1] + range(3)
+        sort(l)
+        print(l)
+        print(3.5 in l)
+        print("3.5" in l)
+        total = 0
+        for x in l * 2
+            total += x
+        end for
+        print(total)
+    )";
+    std::string expected = "[-1, 0, 1, 2, 3.5, 5]1021";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test reductions over numeric lists
+TEST(ListFunctionsTestSuite, Reductions) {
+    std::string code = R"(
+        l = [3, -2.5, 7, 7, 0, 1, -2.5, 4, 9, 9, 2]
+        print(sum(l))
+        print(min(l))
+        print(max(l))
+        print(mean([1, 2, 3, 6]))
+        print(argmin(l))
+        print(argmax(l))
+        print(dot([1, 2, 3], [4, 5, 6]))
+        print(count_if_gt(l, 3))
+        print(count_if_lt(l, 0))
+        r = range(100000)
+        print(sum(r))
+        print(argmax(r[3:]))
+    )";
+    std::string expected = "37-2.593183252499995000099996";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test reductions over empty lists and lists that are no longer numeric
+TEST(ListFunctionsTestSuite, ReductionsEdgeCases) {
+    std::string code = R"(
+        print(sum([]))
+        print(max([]))
+        print(mean([]))
+        l = [5, "x", 8]
+        remove(l, 1)
+        print(sum(l))
+        print(argmin(l))
+    )";
+    std::string expected = "0nilnil130";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that min, max, argmin and argmax propagate NaN the same way for short and long lists
+TEST(ListFunctionsTestSuite, ReductionsWithNaN) {
+    std::string code = R"(
+        n = parse_num("nan")
+        short = [5, n, 1]
+        long = [5, 6, 7, 8, n, 9, 10, 11, 1, 2, 3, 4, 12, 13, 14, 15, 16, 17]
+        for l in [short, long, [n], [1, 2, 3, 4, 5, 6, 7, 8, 9, n]]
+            lo = min(l)
+            hi = max(l)
+            print(lo == lo)
+            print(hi == hi)
+            print(argmin(l))
+            print(argmax(l))
+        end for
+        print(argmin(array(long)))
+        print(min([3, 1, 2, 0.5, 4, 5, 6, 7, 8]))
+    )";
+    std::string expected = "0011" "0044" "0000" "0099" "4" "0.5";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that sort orders NaN and -0 the same way below and above the radix threshold
+TEST(ListFunctionsTestSuite, SortWithNaN) {
+    std::string code = R"(
+        inf = parse_num("inf")
+        special = [parse_num("nan"), 1, 0, inf - inf, -1, -0]
+        short = special[:]
+        long = special + range(300)
+        sort(short)
+        sort(long)
+        print(short)
+        print(long[:5])
+        print(long[-1])
+        print(short[2] ^ -1)  // -0 перед 0
+        print(long[2] ^ -1)
+        print(long[3] ^ -1)
+    )";
+    std::string expected = "[-nan, -1, 0, 0, 1, nan][-nan, -1, 0, 0, 0]nan" "-inf-infinf";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that reductions reject non-numeric elements
+TEST(ListFunctionsTestSuite, ReductionsRejectStrings) {
+    std::string code = R"(
+        print(sum([1, "2"]))
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_FALSE(interpret(input, output));
+}
+
+// Test sort(list, key) evaluates the key once per element and keeps equal keys in order
+TEST(ListFunctionsTestSuite, SortByKey) {
+    std::string code = R"(
+        people = [{"name": "bob", "age": 31}, {"name": "amy", "age": 25}, {"name": "cid", "age": 31}, {"name": "dan", "age": 19}]
+        by_age = function(p)
+            print("k")
+            return p["age"]
+        end function
+        sort(people, by_age)
+        for p in people
+            print(p["name"] + " ")
+        end for
+        words = ["pear", "fig", "banana", "kiwi"]
+        sort(words, function(w) return len(w) end function)
+        print(join(words, ","))
+        sort(words, function(w) return w end function)
+        print(words)
+    )";
+    std::string expected = "kkkkdan amy bob cid fig,pear,kiwi,banana[\"banana\", \"fig\", \"kiwi\", \"pear\"]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test sort(list, cmp) with a two-argument "comes before" function
+TEST(ListFunctionsTestSuite, SortWithComparator) {
+    std::string code = R"(
+        l = [3, 1, 4, 1, 5, 9, 2, 6]
+        sort(l, function(a, b) return a > b end function)
+        print(l)
+        s = ["b", "A", "c", "B"]
+        sort(s, function(a, b) return lower(a) < lower(b) end function)
+        print(s)
+    )";
+    std::string expected = "[9, 6, 5, 4, 3, 2, 1, 1][\"A\", \"b\", \"B\", \"c\"]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test sorting long numeric lists (radix and parallel paths), including negatives and fractions
+TEST(ListFunctionsTestSuite, SortLongNumeric) {
+    std::string code = R"(
+        l = to_list(linspace(600000, -600000, 1200001) * 0.5)
+        push(l, -0.25)
+        sort(l)
+        print(l[0])
+        print(l[-1])
+        a = array(l)
+        print(count_if_lt(a[1:] - a[:-1], 0))
+        m = [2.5, "x", -1]
+        remove(m, 1)
+        push(m, -7)
+        sort(m)
+        print(m)
+    )";
+    std::string expected = "-3000003000000[-7, -1, 2.5]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that a sort function with a wrong number of parameters or mixed keys is an error
+TEST(ListFunctionsTestSuite, SortFunctionErrors) {
+    for (const std::string code : {"sort([1, 2], function() return 1 end function)",
+                                   "sort([1, 2], function(x) if x > 1 then return \"a\" end if return 1 end function)"}) {
+        std::istringstream input(code);
+        std::ostringstream output;
+        ASSERT_FALSE(interpret(input, output));
+    }
+}
+
+// Test that a frozen list and the lists inside it can be read and copied but not changed
+TEST(ListFunctionsTestSuite, FreezeList) {
+    std::string code = R"(
+        inner = [1, 2]
+        l = freeze([inner, "a", 3])
+        copy = l
+        tail = l[1:]
+        push(tail, 4)
+        print(len(copy))
+        print(tail)
+        print(l[0][1])
+        cycle = []
+        push(cycle, cycle)
+        freeze(cycle)
+        print(len(cycle))
+    )";
+    std::string expected = "3[\"a\", 3, 4]21";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+
+    for (const std::string mutation : {"push(l, 1)", "sort(freeze([3, 1]))", "pop(inner)", "remove(l, 0)", "freeze(1)"}) {
+        std::istringstream bad("inner = [3, 1]\nl = freeze([inner, 2])\n" + mutation);
+        std::ostringstream bad_output;
+        ASSERT_FALSE(interpret(bad, bad_output)) << mutation;
+    }
+}
+
+// Test that list and array elements are assigned in place through every alias
+TEST(ListFunctionsTestSuite, IndexAssignment) {
+    std::string code = R"(
+        l = [1, 2, 3]
+        alias = l
+        l[0] = 10
+        l[-1] += 5
+        alias[1] *= 3
+        print(l[0] + l[1] + l[2])
+        l[1] = "x"
+        l[1] += "y"
+        grid = [[0, 0], [0, 0]]
+        for r in range(2)
+            for c in range(2)
+                grid[r][c] = r * 2 + c
+            end for
+        end for
+        grid[1][0] += 10
+        a = zeros(3)
+        a[2] = 7
+        a[-1] -= 1
+        print(a[2])
+        print(alias)
+        print(grid)
+    )";
+    std::string expected = "246[10, \"xy\", 8][[0, 1], [12, 3]]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+
+    for (const std::string bad_code : {"l = [1]\nl[1] = 2", "l = [1]\nl[-2] = 2", "l = freeze([1])\nl[0] = 2",
+                                       "s = \"ab\"\ns[0] = \"c\"", "l = [1]\nl[\"a\"] = 2", "l = [1]\nl[0:1] = [2]",
+                                       "a = zeros(2)\na[0] = \"x\""}) {
+        std::istringstream bad(bad_code);
+        std::ostringstream bad_output;
+        ASSERT_FALSE(interpret(bad, bad_output)) << bad_code;
+    }
+}
@@ -0,0 +1,152 @@
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+// Test map literal and printing
+TEST(MapTestSuite, Literal) {
+    std::string code = R"(
+        m = {"a": 1, "b": "two", 3: [1, 2],}
+        print(m)
+    )";
+    std::string expected = "{\"a\": 1, \"b\": \"two\", 3: [1, 2]}";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test indexing by key (missing key gives nil)
+TEST(MapTestSuite, Index) {
+    std::string code = R"(
+        m = {"x": 10, 2: 20}
+        print(m["x"])
+        print(m[2])
+        print(m["missing"])
+    )";
+    std::string expected = "1020nil";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test keys(), values() and len() keep insertion order
+TEST(MapTestSuite, KeysValues) {
+    std::string code = R"(
+        m = {"b": 2, "a": 1, "c": 3}
+        print(keys(m))
+        print(values(m))
+        print(len(m))
+    )";
+    std::string expected = "[\"b\", \"a\", \"c\"][2, 1, 3]3";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test has(), put() and del()
+TEST(MapTestSuite, HasPutDel) {
+    std::string code = R"(
+        m = {}
+        put(m, "k", 1)
+        put(m, "k", 2)
+        print(has(m, "k"))
+        print(m["k"])
+        print(del(m, "k"))
+        print(has(m, "k"))
+        print(del(m, "k"))
+        print(m)
+    )";
+    std::string expected = "1220nil{}";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test counting words with many inserts and deletes
+TEST(MapTestSuite, Aggregation) {
+    std::string code = R"(
+        counts = {}
+        for i in range(1000)
+            k = i % 7
+            if has(counts, k) then
+                put(counts, k, counts[k] + 1)
+            else
+                put(counts, k, 1)
+            end if
+        end for
+        for i in range(3)
+            del(counts, i)
+        end for
+        print(counts)
+    )";
+    std::string expected = "{3: 143, 4: 143, 5: 143, 6: 142}";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that lists cannot be used as keys
+TEST(MapTestSuite, UnhashableKey) {
+    std::string code = R"(
+        m = {[1]: 2}
+        print(239)
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_FALSE(interpret(input, output));
+    ASSERT_FALSE(output.str().ends_with("239"));
+}
+
+// Test that map entries are assigned and updated by key
+TEST(MapTestSuite, IndexAssignment) {
+    std::string code = R"(
+        h = {}
+        for w in ["a", "b", "a", "c", "a"]
+            if has(h, w) then h[w] += 1 else h[w] = 1 end if
+        end for
+        print(h["a"])
+        print(h["b"])
+        h[1] = "one"
+        h[1] *= 2
+        print(h[1])
+        print(len(h))
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "31oneone4");
+
+    std::istringstream bad("h = {}\nh[\"k\"] += 1");
+    std::ostringstream bad_output;
+    ASSERT_FALSE(interpret(bad, bad_output));
+}
+
+// Test that lists and maps containing themselves are printed without endless recursion
+TEST(MapTestSuite, PrintSelfReference) {
+    std::string code = R"(
+        a = [1]
+        push(a, a)
+        m = {}
+        m["self"] = m
+        m["list"] = a
+        println(a)
+        println(m)
+        print([a, a])
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "[1, [...]]\n{\"self\": {...}, \"list\": [1, [...]]}\n[[1, [...]], [1, [...]]]");
+}
@@ -0,0 +1,215 @@
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+// Test that constant expressions are folded before execution
+TEST(OptimizerTestSuite, ConstantFolding) {
+    std::string code = R"(
+        a = 2 ^ 10
+        s = "a" * 3
+        b = -(1 + 2) * 2
+        print(a)
+        print(s)
+        print(b)
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream dump;
+    ASSERT_TRUE(dump_optimized_ast(input, dump));
+    ASSERT_EQ(dump.str(),
+              "Assign a =\n  Number 1024\n"
+              "Assign s =\n  String \"aaa\"\n"
+              "Assign b =\n  Number -6\n"
+              "Print\n  Variable a\n"
+              "Print\n  Variable s\n"
+              "Print\n  Variable b\n");
+
+    std::istringstream run(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(run, output));
+    ASSERT_EQ(output.str(), "1024aaa-6");
+}
+
+// Test that folding keeps runtime errors where they would happen
+TEST(OptimizerTestSuite, ErrorsStayAtRuntime) {
+    std::string code = R"(
+        f = function() return 1 / 0 end function
+        print("ok")
+        if false then
+            print(1 / 0)
+        end if
+        x = "a" - 1
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_FALSE(interpret(input, output));
+    ASSERT_TRUE(output.str().find("Недопустимые операнды") != std::string::npos);
+    ASSERT_TRUE(output.str().find("Деление на ноль") == std::string::npos);
+
+    std::istringstream division("print(1 / 0)");
+    std::ostringstream division_output;
+    ASSERT_FALSE(interpret(division, division_output));
+    ASSERT_TRUE(division_output.str().find("Деление на ноль") != std::string::npos);
+}
+
+// Test that branches with constant conditions are removed
+TEST(OptimizerTestSuite, DeadBranches) {
+    std::string code = R"(
+        if false then
+            print("never")
+        else if true then
+            print("always")
+        else
+            print("else")
+        end if
+        while nil
+            print("loop")
+        end while
+        if 0 then print(0) end if
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream dump;
+    ASSERT_TRUE(dump_optimized_ast(input, dump));
+    ASSERT_EQ(dump.str(), "Print\n  String \"always\"\n");
+
+    std::istringstream run(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(run, output));
+    ASSERT_EQ(output.str(), "always");
+}
+
+// Test that x * 1 and x + 0 keep their meaning for every operand type
+TEST(OptimizerTestSuite, NumericIdentities) {
+    std::string code = R"(
+        x = 7
+        s = "ab"
+        l = [1, 2]
+        m = l * 1
+        push(m, 3)
+        print(x * 1 + 0 - 0)
+        print(1 * x / 1)
+        print(s * 1)
+        print(len(l))
+        print(s + 0)
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "77ab2ab0");
+}
+
+// Test that a string literal printed with spaces keeps its quoting rule only for real literals
+TEST(OptimizerTestSuite, PrintedStringConcatenation) {
+    std::string code = R"(
+        print("a" + " b")
+        print("c d")
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "a b\"c d\"");
+}
+
+// Test that invariant subexpressions of loop conditions and bodies are hoisted
+TEST(OptimizerTestSuite, LoopInvariantHoisting) {
+    std::string code = R"(
+        arr = [1, 2, 3]
+        n = 3
+        i = 0
+        while i < len(arr)
+            print(arr[i] * (n * n))
+            i += 1
+        end while
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream dump;
+    ASSERT_TRUE(dump_optimized_ast(input, dump));
+    ASSERT_TRUE(dump.str().find("Invariant\n      Call\n        Variable len") != std::string::npos);
+    ASSERT_TRUE(dump.str().find("Invariant\n          Binary *\n            Variable n") != std::string::npos);
+    ASSERT_TRUE(dump.str().find("Invariant\n          Index") == std::string::npos);
+
+    std::istringstream run(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(run, output));
+    ASSERT_EQ(output.str(), "91827");
+}
+
+// Test that hoisting respects assignments and list mutation inside the loop
+TEST(OptimizerTestSuite, LoopInvariantMutation) {
+    std::string code = R"(
+        arr = [1, 2, 3]
+        alias = arr
+        i = 0
+        while i < len(arr)
+            if i < 2 then push(alias, i) end if
+            i += 1
+        end while
+        print(i)
+        s = 0
+        for x in range(3)
+            k = x
+            s += k * 10
+        end for
+        print(s)
+        fresh = 0
+        for x in range(3)
+            part = [0] + [1]
+            push(part, x)
+            fresh += len(part)
+        end for
+        print(fresh)
+        grown = 0
+        j = 0
+        while j < 3
+            grown += len(alias)
+            arr += [j]
+            j += 1
+        end while
+        print(grown)
+        cells = [0, 0]
+        view = cells
+        seen = 0
+        for x in range(3)
+            seen += view[0]
+            cells[0] = x + 1
+        end for
+        print(seen)
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "5309183");
+}
+
+// Test that a loop re-entered through recursion keeps separate invariant values
+TEST(OptimizerTestSuite, LoopInvariantRecursion) {
+    std::string code = R"(
+        walk = function(depth, self)
+            total = 0
+            for x in range(2)
+                total += depth * 100
+                if depth > 0 then total += self(depth - 1, self) end if
+                total += depth * 100
+            end for
+            return total
+        end function
+        print(walk(2, walk))
+        len = function(x) return 42 end function
+        i = 0
+        while i < len(i)
+            i += 1
+        end while
+        print(i)
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "160042");
+}
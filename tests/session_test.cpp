@@ -0,0 +1,112 @@
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+#include <lib/runtime/types.h>
+#include <sstream>
+#include <thread>
+
+// Test that variables and functions persist between inputs and output appears per input
+TEST(SessionTestSuite, PersistentEnvironment) {
+    std::istringstream data;
+    std::ostringstream output;
+    Session session(output, data);
+
+    ASSERT_EQ(session.feed("x = 20"), Session::Status::Done);
+    ASSERT_EQ(output.str(), "");
+    ASSERT_EQ(session.feed("double = function(a) return a * 2 end function"), Session::Status::Done);
+    ASSERT_EQ(session.feed("print(double(x) + 2)"), Session::Status::Done);
+    ASSERT_EQ(output.str(), "42");
+    ASSERT_EQ(session.feed("x += 1 print(x)"), Session::Status::Done);
+    ASSERT_EQ(output.str(), "4221");
+}
+
+// Test that an unfinished block waits for more lines and runs once it is closed
+TEST(SessionTestSuite, MultiLineBlocks) {
+    std::istringstream data;
+    std::ostringstream output;
+    Session session(output, data);
+
+    ASSERT_EQ(session.feed("total = 0"), Session::Status::Done);
+    ASSERT_EQ(session.feed("for i in range(4)"), Session::Status::NeedMore);
+    ASSERT_EQ(session.feed("    total += i"), Session::Status::NeedMore);
+    ASSERT_EQ(output.str(), "");
+    ASSERT_EQ(session.feed("end for"), Session::Status::Done);
+    ASSERT_EQ(session.feed("print(total"), Session::Status::NeedMore);
+    ASSERT_EQ(session.feed(")"), Session::Status::Done);
+    ASSERT_EQ(session.feed("s = \"two"), Session::Status::NeedMore);
+    ASSERT_EQ(session.feed("lines\" print(len(s))"), Session::Status::Done);
+    ASSERT_EQ(output.str(), "69");
+}
+
+// Test that errors are reported without losing the session state
+TEST(SessionTestSuite, ErrorRecovery) {
+    std::istringstream data;
+    std::ostringstream output;
+    Session session(output, data);
+
+    ASSERT_EQ(session.feed("a = [1, 2]"), Session::Status::Done);
+    ASSERT_EQ(session.feed("a = )"), Session::Status::Error);
+    ASSERT_EQ(session.feed("print(\"ok\") print(missing) print(\"never\")"), Session::Status::Error);
+    ASSERT_EQ(session.feed("if a then"), Session::Status::NeedMore);
+    ASSERT_EQ(session.feed(""), Session::Status::Error);
+    ASSERT_EQ(session.feed("return 1"), Session::Status::Error);
+    output.str("");
+    ASSERT_EQ(session.feed("print(a)"), Session::Status::Done);
+    ASSERT_EQ(output.str(), "[1, 2]");
+}
+
+// Test that read() consumes the session's data stream across inputs
+TEST(SessionTestSuite, DataStream) {
+    std::istringstream data("first\nsecond\n");
+    std::ostringstream output;
+    Session session(output, data);
+
+    ASSERT_EQ(session.feed("print(read())"), Session::Status::Done);
+    ASSERT_EQ(session.feed("print(to_list(lines()))"), Session::Status::Done);
+    ASSERT_EQ(output.str(), "first[\"second\"]");
+}
+
+// Test that sessions keep their own heap: values outlive other sessions and their inputs
+TEST(SessionTestSuite, IndependentHeaps) {
+    std::istringstream data;
+    std::ostringstream first_output;
+    std::ostringstream second_output;
+    Session first(first_output, data);
+    {
+        Session second(second_output, data);
+        ASSERT_EQ(first.feed("words = [] for i in range(200) push(words, \"w\" + to_string(i)) end for"), Session::Status::Done);
+        ASSERT_EQ(second.feed("kept = [[1, 2], {\"k\": \"v\"}] cycle = [] push(cycle, cycle) freeze(cycle)"), Session::Status::Done);
+        ASSERT_EQ(first.feed("words = words[150:] push(words, \"end\")"), Session::Status::Done);
+        ASSERT_EQ(second.feed("print(kept[1][\"k\"] + to_string(len(kept[0])))"), Session::Status::Done);
+    }
+    ASSERT_EQ(first.feed("print(len(words)) print(words[0] + words[50])"), Session::Status::Done);
+    ASSERT_EQ(first_output.str(), "51w150end");
+    ASSERT_EQ(second_output.str(), "v2");
+}
+
+// Test that frozen values outlive the heap they were built in and may be released by another thread
+TEST(SessionTestSuite, FrozenValuesOutliveHeap) {
+    List shared;
+    {
+        HeapPool heap;
+        HeapPool::Scope scope(heap);
+        auto list = make_ref<ListValue>();
+        for (int i = 0; i < 1000; ++i) {
+            auto row = make_ref<ListValue>();
+            row->push(static_cast<double>(i));
+            row->push(Str("row " + std::to_string(i) + " with a long enough label"));
+            list->push(row);
+        }
+        list->freeze();
+        shared = list;
+    }
+    HeapPool heap;
+    HeapPool::Scope scope(heap);
+    std::thread reader([copy = shared]() mutable {
+        size_t total = 0;
+        for (size_t i = 0; i < copy->size(); ++i) total += std::get<List>(copy->get(i))->size();
+        ASSERT_EQ(total, 2000u);
+    });
+    shared = List();
+    for (int i = 0; i < 1000; ++i) make_ref<ListValue>()->push(Str("local " + std::to_string(i) + " value padded out"));
+    reader.join();
+}
@@ -0,0 +1,108 @@
+#include <lib/interpreter.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+// Test set(list) removes duplicates and keeps first-seen order
+TEST(SetTestSuite, FromList) {
+    std::string code = R"(
+        s = set([3, 1, 3, "a", 1, "a"])
+        print(s)
+        print(len(s))
+    )";
+    std::string expected = "{3, 1, \"a\"}3";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test add(), has() and remove()
+TEST(SetTestSuite, AddHasRemove) {
+    std::string code = R"(
+        s = set()
+        add(s, 5)
+        add(s, 5)
+        add(s, "x")
+        print(has(s, 5))
+        print(has(s, 6))
+        print(remove(s, 5))
+        print(remove(s, 5))
+        print(len(s))
+    )";
+    std::string expected = "10101";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test union(), intersect() and difference()
+TEST(SetTestSuite, BulkOperations) {
+    std::string code = R"(
+        a = set([1, 2, 3, 4])
+        b = set([3, 4, 5])
+        print(union(a, b))
+        print(intersect(a, b))
+        print(difference(a, b))
+    )";
+    std::string expected = "{1, 2, 3, 4, 5}{3, 4}{1, 2}";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test the in operator for sets, maps, lists and strings
+TEST(SetTestSuite, InOperator) {
+    std::string code = R"(
+        s = set(["a", "b"])
+        print("a" in s)
+        print("c" in s)
+        print(2 in {2: "x"})
+        print(nil in [1, nil])
+        print("ell" in "hello")
+    )";
+    std::string expected = "10111";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test for loop over a set
+TEST(SetTestSuite, ForLoop) {
+    std::string code = R"(
+        total = 0
+        for x in set([1, 2, 2, 3])
+            total += x
+        end for
+        print(total)
+    )";
+    std::string expected = "6";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that an empty set prints as set(), unlike an empty map
+TEST(SetTestSuite, PrintEmpty) {
+    std::string code = R"(
+        s = set([1])
+        remove(s, 1)
+        print(s)
+        print([set(), {}])
+        print(difference(set([1, 2]), set([2, 1])))
+    )";
+    std::string expected = "set()[set(), {}]set()";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
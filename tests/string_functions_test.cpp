@@ -79,3 +79,97 @@ TEST(StringFunctionsTestSuite, Replace) {
     ASSERT_TRUE(interpret(input, output));
     ASSERT_EQ(output.str(), expected);
 }
+
+// Test builder(), append() and build()
+TEST(StringFunctionsTestSuite, Builder) {
+    std::string code = R"(
+        b = builder("x=")
+        append(b, 1)
+        append(b, ", ")
+        append(b, "y=")
+        append(b, 2.5)
+        print(len(b))
+        print(build(b))
+    )";
+    std::string expected = "10x=1, y=2.5";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test building a long string in a loop
+TEST(StringFunctionsTestSuite, BuilderLoop) {
+    std::string code = R"(
+        b = builder()
+        for i in range(100000)
+            append(b, "ab")
+        end for
+        s = build(b)
+        print(len(s))
+        print(s[0:6])
+    )";
+    std::string expected = "200000ababab";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test find(), contains(), starts_with() and count()
+TEST(StringFunctionsTestSuite, SearchFunctions) {
+    std::string code = R"(
+        s = "the quick brown fox jumps over the lazy dog, the end"
+        print(find(s, "the"))
+        print(find(s, "dog"))
+        print(find(s, "cat"))
+        print(contains(s, "lazy"))
+        print(contains(s, "crazy"))
+        print(starts_with(s, "the quick"))
+        print(starts_with(s, "quick"))
+        print(count(s, "the"))
+        print(count("aaaa", "aa"))
+    )";
+    std::string expected = "040-1101032";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test search and replace on strings longer than one SIMD block
+TEST(StringFunctionsTestSuite, LongStrings) {
+    std::string code = R"(
+        s = "0123456789abcdefghijklmnopqrstuvwxyz" * 4 + "NEEDLE" + "0123456789"
+        print(find(s, "NEEDLE"))
+        print(find(s, "z0"))
+        print(count(s, "xyz"))
+        print(len(replace(s, "abc", "")))
+        print(upper(s)[140:150])
+        print(lower("ÀBC Déf GHI JKL MNO PQR STU VWX YZ"))
+    )";
+    std::string expected = "144354148WXYZNEEDLEÀbc déf ghi jkl mno pqr stu vwx yz";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test split() with an empty delimiter and a multi-character delimiter
+TEST(StringFunctionsTestSuite, SplitEdgeCases) {
+    std::string code = R"(
+        print(split("abc", ""))
+        print(split("a::b::::c", "::"))
+        print(replace("a-b-c", "-", "--"))
+    )";
+    std::string expected = "[\"a\", \"b\", \"c\"][\"a\", \"b\", \"\", \"c\"]a--b--c";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
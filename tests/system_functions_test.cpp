@@ -58,3 +58,125 @@ TEST(SystemFunctionsTestSuite, StackTraceFunction) {
     ASSERT_TRUE(interpret(input, output));
     ASSERT_EQ(output.str(), expected);
 }
+
+// Test stacktrace() lists user function calls with call-site lines, outermost first
+TEST(SystemFunctionsTestSuite, StackTraceInsideCalls) {
+    std::string code = R"(inner = function()
+    return stacktrace()
+end function
+outer = function(x)
+    t = inner()
+    return t
+end function
+print(outer(1))
+via_tail = function() return inner() end function
+print(via_tail())
+print(stacktrace())
+)";
+    std::string expected = "[\"outer (строка 8)\", \"inner (строка 5)\"][\"inner (строка 9)\"][]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test read() returns lines of the data stream, then empty strings at the end
+TEST(SystemFunctionsTestSuite, ReadDataLines) {
+    std::string code = R"(
+        a = read()
+        b = read()
+        print(parse_num(a) + parse_num(b))
+        print(eof())
+        print("[" + read() + "]")
+        print("[" + read() + "]")
+        print(eof())
+        print("[" + read() + "]")
+    )";
+    std::string expected = "420[][last]1[]";
+
+    std::istringstream input(code);
+    std::istringstream data("40\r\n2\n\nlast");
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output, data));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test lines() is walked lazily by for and shares the position with read()
+TEST(SystemFunctionsTestSuite, LinesIterator) {
+    std::string code = R"(
+        header = read()
+        total = 0
+        for line in lines()
+            if line == "stop" then
+                break
+            end if
+            total += parse_num(split(line, ",")[1])
+        end for
+        print(header + ": " + to_string(total))
+        print(to_list(lines()))
+        print(len(to_list(lines())))
+    )";
+    std::string expected = "name,value: 60[\"rest\", \"more\"]0";
+
+    std::istringstream input(code);
+    std::istringstream data("name,value\na,10\nb,20\nc,30\nstop\nrest\nmore\n");
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output, data));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test lines longer than the internal read buffer and many short lines
+TEST(SystemFunctionsTestSuite, LongInputLines) {
+    std::string code = R"(
+        count = 0
+        longest = 0
+        for line in lines()
+            count += 1
+            if len(line) > longest then
+                longest = len(line)
+            end if
+        end for
+        print(to_string(count) + "/" + to_string(longest))
+    )";
+    std::string data_text;
+    for (int i = 0; i < 50000; ++i) data_text += "line " + std::to_string(i) + "\n";
+    data_text += std::string(3000000, 'x') + "\nend";
+    std::string expected = "50002/3000000";
+
+    std::istringstream input(code);
+    std::istringstream data(data_text);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output, data));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test gc() frees unreachable reference cycles and keeps reachable ones intact
+TEST(SystemFunctionsTestSuite, CollectCycles) {
+    std::string code = R"(
+        gc()
+        for i in range(10)
+            a = []
+            push(a, a)
+            m = {"self": 0}
+            put(m, "self", m)
+        end for
+        kept = [1]
+        push(kept, kept)
+        print(gc())
+        print(len(kept[1][1]))
+        stats = gc_stats()
+        print(stats["collections"] > 1)
+        print(stats["collected"] >= 27)
+    )";
+    std::string expected = "27211";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
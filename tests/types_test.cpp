@@ -172,6 +172,66 @@ TEST(ListTestSuite, ListSlicing) {
     ASSERT_EQ(output.str(), expected);
 }
 
+TEST(ListTestSuite, SliceCopyOnWrite) {
+    std::string code = R"(
+        l = [1, 2, 3, 4, 5]
+        s = l[1:4]
+        push(s, 10)      // slice gets its own copy
+        insert(l, 0, 0)  // parent is not affected by the slice and vice versa
+        t = l[2:]
+        remove(l, 2)
+        print(s)
+        print(l)
+        print(t)
+    )";
+
+    std::string expected = "[2, 3, 4, 10][0, 1, 3, 4, 5][2, 3, 4, 5]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(ListTestSuite, RecursiveSliceStyle) {
+    std::string code = R"(
+        total = 0
+        rest = range(20000)
+        while len(rest) > 0
+            total += rest[0]
+            rest = rest[1:]
+        end while
+        print(total)
+    )";
+
+    std::string expected = "199990000";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(StringTestSuite, SliceOfSlice) {
+    std::string code = R"(
+        s = "Hello, World"
+        t = s[7:]
+        print(t[:3])
+        print(t[-1])
+        print(s[0:5] + "!")
+    )";
+
+    std::string expected = "WordHello!";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
 TEST(ListTestSuite, MixedTypes) {
     std::string code = R"(
         l = [1, "hello", 3.14, "world"]
@@ -258,6 +318,31 @@ TEST(NumberTestSuite, ArithmeticOperations) {
     ASSERT_EQ(output.str(), expected);
 }
 
+// Test integer-valued numbers: exact % and ^, formatting and indexing beyond 32 bits
+TEST(NumberTestSuite, IntegerValues) {
+    std::string code = R"(
+        print(-7 % 3)            // -1
+        print(7 % -3)            // 1
+        print(2 ^ 62)            // 4611686018427387904
+        print(3 ^ 33)            // 5559060566555523
+        print((-3) ^ 3)          // -27
+        print(2 ^ -2)            // 0.25
+        print(2 ^ 70 > 2 ^ 69)   // 1
+        print(3000000000 + 1)    // 3000000001
+        print(-3000000000 * 2)   // -6000000000
+        print([1, 2][1e30])      // nil
+        print("ab"[-1e30])       // nil
+        print([1, 2, 3][-5000000000:2])
+    )";
+    std::string expected = "-1146116860184273879045559060566555523-270.2513000000001-6000000000nilnil[1, 2]";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
 TEST(LogicTestSuite, LogicalOperations) {
     std::string code = R"(
         a = true
@@ -309,6 +394,56 @@ TEST(AssignmentTestSuite, CompoundAssignments) {
     ASSERT_EQ(output.str(), expected);
 }
 
+// Test that += and *= extend strings and lists in place: lists change through every reference, strings do not
+TEST(AssignmentTestSuite, CompoundAssignmentsInPlace) {
+    std::string code = R"(
+        s = "ab"
+        t = s
+        s += "c"
+        s += 1
+        u = s[0:2]
+        s *= 2
+        s += s
+        println(s + " " + t + " " + u)
+        l = [1, 2]
+        alias = l
+        l += [3]
+        l *= 2
+        println(len(alias) * 10 + alias[5])
+        l += l
+        println(len(alias))
+        f = freeze([1])
+        f += [2]
+        println(f)
+        l *= 0
+        println(len(alias))
+        big = ""
+        for i in range(1000)
+            big += "x"
+        end for
+        print(len(big))
+    )";
+
+    std::string expected = "abc1abc1abc1abc1 ab ab\n63\n12\n[1, 2]\n0\n1000";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+// Test that repeating in place past the addressable size is an error, not an overflow
+TEST(AssignmentTestSuite, CompoundRepeatOverflow) {
+    for (const std::string code : {"s = \"abcd\"\ns *= 2 ^ 62", "s = \"abc\"\ns *= 2 ^ 62",
+                                   "l = [1, 2, 3, 4]\nl *= 2 ^ 62", "l = [1, \"a\"]\nl *= 2 ^ 63"}) {
+        std::istringstream input(code);
+        std::ostringstream output;
+        ASSERT_FALSE(interpret(input, output)) << code;
+        ASSERT_TRUE(output.str().starts_with("Ошибка: Слишком длинн")) << output.str();
+    }
+}
+
 
 //!!!!!!!!! умн на нецелое число строку
 
@@ -328,6 +463,27 @@ TEST(StringTestSuite, StringMultiplicationFloat) {
     ASSERT_EQ(output.str(), expected);
 }
 
+// Test that multiplying by a count past the addressable size is an error, not a hang
+TEST(StringTestSuite, MultiplicationOverflow) {
+    for (const std::string code : {"print(\"abcd\" * 2 ^ 62)", "print(\"abc\" * 2 ^ 63)",
+                                   "print([1, 2, 3, 4] * 2 ^ 62)", "print([1, \"a\"] * 2 ^ 63)"}) {
+        std::istringstream input(code);
+        std::ostringstream output;
+        ASSERT_FALSE(interpret(input, output)) << code;
+        ASSERT_TRUE(output.str().starts_with("Ошибка: Слишком длинн")) << output.str();
+    }
+
+    std::string code = R"(
+        print(len("" * 2 ^ 62))
+        print(len([] * 2 ^ 62))
+        print(len("ab" * (2 ^ 1100 - 2 ^ 1100)))
+    )";
+    std::istringstream input(code);
+    std::ostringstream output;
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), "000");
+}
+
 TEST(StringTestSuite, StringSubtractionInvalidSuffix) {
     std::string code = R"(
         s = "Hello World"
@@ -470,3 +626,36 @@ TEST(EmptyTestSuite, EmptyStringAndList) {
     ASSERT_EQ(output.str(), expected);
 }
 
+
+// Test that an operator keeps working after the operand types it was specialized for change
+TEST(MixedTestSuite, OperatorsChangingOperandTypes) {
+    std::string code = R"(
+        add = function(a, b) return a + b end function
+        less = function(a, b) return a < b end function
+        print(add(1, 2))
+        print(add(3, 4))
+        print(add("x", "y"))
+        print(add("n", 5))
+        print(add([1], [2]))
+        print(add(5, 6))
+        print(less("a", "b"))
+        print(less(2, 1))
+        for v in [1, "s", 2.5]
+            x = v
+            x += v
+            print(x)
+        end for
+    )";
+    std::string expected = "37xyn5[1, 2]11102ss5";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(interpret(input, output));
+    ASSERT_EQ(output.str(), expected);
+
+    std::istringstream division("d = function(a, b) return a / b end function\nprint(d(1, 2))\nprint(d(1, 0))");
+    std::ostringstream division_output;
+    ASSERT_FALSE(interpret(division, division_output));
+    ASSERT_EQ(division_output.str().rfind("Ошибка: Деление на ноль", 0), 0u);
+}